@@ -11,6 +11,11 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
 
 const char* vtx = R"(
 #version 330 core
@@ -24,52 +29,65 @@ void main() {
 }
 )";
 
+// #version and the quality #defines (MAX_STEPS, LIGHT_SAMPLES, FBM_OCTAVES,
+// SHADOWS, STARS, NEBULA) are put in front by mkProg
 const char* frag = R"(
-#version 330 core
 out vec4 FragColor;
 in vec2 uv;
 uniform float t;
 uniform vec3 cam;
 uniform vec2 res;
+uniform sampler2D noise2;  // value-noise lattice, see bakeNoise2
+uniform sampler3D noise3;  // fbm3 pre-summed, see bakeNoise3
+uniform sampler2D lens;    // where rays end up, see bakeLensing
+uniform float tol;         // quality: opacity a step may get wrong, see march
 
 const float sr = 0.12;
 const float eh = 0.18;
 const float di = 0.35;
 const float do_ = 4.5;
-const int MAX_STEPS = 256;
-const int LIGHT_SAMPLES = 4;
+const float SHADOW_LENGTH = .8;  // how far towards the light shadows are looked for
+const float MAX_STRETCH = 2.;  // longest step through the disk, in fixed steps
+const float LENS_RMIN = 1.;  // camera radii the lensing table covers
+const float LENS_RMAX = 6.;
+const float PI = 3.14159265;
+
+const float NOISE2=256.;  // lattice cells before noise2 repeats
+const float NOISE3=1./32.;  // noise3 repeats every 32 units of fbm3's p, 8 world units
 
 float h(vec2 p){return fract(sin(dot(p,vec2(127.1,311.7)))*43758.5453);}
-float h3(vec3 p){return fract(sin(dot(p,vec3(127.1,311.7,74.7)))*43758.5453);}
 
+// smoothstep the fraction, then bilinear filtering does the two mixes
 float n(vec2 p){
     vec2 i=floor(p),f=fract(p);
     f=f*f*(3.0-2.0*f);
-    float a=h(i),b=h(i+vec2(1,0)),c=h(i+vec2(0,1)),d=h(i+vec2(1,1));
-    return mix(mix(a,b,f.x),mix(c,d,f.x),f.y);
+    return textureLod(noise2,(mod(i,NOISE2)+f+.5)/NOISE2,0.).r;
 }
 
 float fbm(vec2 p){
     float val=0,amp=.5,freq=1;
-    for(int i=0;i<6;i++){
+    for(int i=0;i<FBM_OCTAVES;i++){
         val+=amp*n(p*freq);
         freq*=2.1;amp*=.48;
     }
+    // octaves left out still add their average, so fewer don't dim it
+    for(int i=FBM_OCTAVES;i<6;i++){
+        val+=amp*.5;
+        amp*=.48;
+    }
     return val;
 }
 
 float fbm3(vec3 p){
-    float val=0,amp=.5;
-    for(int i=0;i<4;i++){
-        val+=amp*(h3(p)-.5);
-        p*=2.1;amp*=.5;
-    }
-    return val*.5+.5;
+    return textureLod(noise3,p*NOISE3,0.).r;
 }
 
+// half-height of the disk slab
+float thickness(){return .4+.25*sin(t*.8);}
+
 float getDensity(vec3 pos,float r){
     float dh=abs(pos.y);
-    float dt=.4+.25*sin(t*.8);
+    float dt=thickness();
     if(dh>=dt||r<=di||r>=do_)return 0.;
     
     float dn=(r-di)/(do_-di);
@@ -147,14 +165,17 @@ vec3 calcLighting(vec3 pos,vec3 d,float dens){
     vec3 lightDir=normalize(vec3(.3,.8,.5));
     
     float shadow=1.;
+#if SHADOWS
+    float ds=SHADOW_LENGTH/float(LIGHT_SAMPLES);
     vec3 p=pos;
-    for(int i=0;i<4;i++){
-        p+=lightDir*.2;
+    for(int i=0;i<LIGHT_SAMPLES;i++){
+        p+=lightDir*ds;
         float r=length(p);
         float sd=getDensity(p,r);
-        shadow*=exp(-sd*.3);
+        shadow*=exp(-sd*1.5*ds);
         if(shadow<.05)break;
     }
+#endif
     
     float diff=max(dot(normalize(vec3(0,1,0)),lightDir),0.)*.5+.5;
     float rim=pow(1.-abs(dot(d,normalize(pos))),2.)*.3;
@@ -162,11 +183,57 @@ vec3 calcLighting(vec3 pos,vec3 d,float dens){
     return vec3(diff*shadow+rim);
 }
 
+// The ray from o along d, from the lensing table: its direction once far
+// from the hole, and the closest it comes. False if the hole captures it.
+bool lensed(vec3 o,vec3 d,out vec3 far,out float rmin){
+    float R=length(o);
+    vec3 e1=o/R;
+    float c=clamp(dot(d,e1),-1.,1.);
+    vec3 e2=d-c*e1;
+    e2=dot(e2,e2)>1e-12?normalize(e2):vec3(0);  // radial rays go straight
+    float a=acos(c);
+    vec2 l=textureLod(lens,vec2(1.-sqrt(1.-a/PI),(R-LENS_RMIN)/(LENS_RMAX-LENS_RMIN)),0.).rg;
+    far=cos(a+l.x)*e1+sin(a+l.x)*e2;
+    rmin=l.y;
+    return rmin>eh;
+}
+
+vec3 sky(vec3 sd){
+    vec3 col=vec3(0);
+#if STARS
+    float sn=h(sd.xy*280+sd.z*150);
+    if(sn>.9978){
+        float sb=(sn-.9978)*2000;
+        vec3 sc=mix(vec3(1.,.96,.88),vec3(.88,.96,1.),h(sd.yz*165));
+        float twinkle=.65+.35*sin(sn*1200.+t*6.);
+        col+=sc*sb*twinkle;
+    }
+#endif
+    
+#if NEBULA
+    float bg=fbm(sd.xy*5.+t*.025)*.05;
+    vec3 nebula=mix(vec3(.06,.03,.1),vec3(.1,.05,.15),bg);
+    nebula+=vec3(.02,.01,.03)*fbm(sd.yz*3.-t*.02);
+    col+=nebula;
+#endif
+    
+    col+=vec3(.0008,.0015,.006);
+    return col;
+}
+
 vec3 march(vec3 o,vec3 d){
+    vec3 far;
+    float rmin;
+    bool escapes=lensed(o,d,far,rmin);
+    // a ray that never comes inside do_ can't meet the disk
+    if(rmin>do_)return sky(far);
+    
     vec3 pos=o;
     float td=0;
     vec3 col=vec3(0);
     float alpha=0;
+    float dt=thickness();
+    float w=1.,prev=0.;  // last step, in fixed steps, and the density at its start
     
     for(int i=0;i<MAX_STEPS;i++){
         float r=length(pos);
@@ -178,6 +245,27 @@ vec3 march(vec3 o,vec3 d){
         
         float dens=getDensity(pos,r);
         
+        float g=(sr*sr)/(r*r+.006);
+        vec3 gd=-normalize(pos);
+        
+        float step=.02+r*.01;
+        if(r>di-.7&&r<do_+.7)step*=.3;
+        
+        // The last step took its opacity from the density at its start, so it
+        // is off by about half what the density changed across it. That error
+        // goes as the square of the step: size this one to make it tol, long
+        // where the disk is smooth and down to the fixed step where it's steep.
+        float err=.125*abs(dens-prev)*w;
+        w=clamp(w*clamp(sqrt(tol/max(err,1e-6)),.5,2.),1.,MAX_STRETCH);
+        prev=dens;
+        
+        // Density needs |y|<dt and di<r<do_, so nothing within `clear` of
+        // pos is disk or horizon, and a path that long stays empty however
+        // it bends: stride across it. Bend by as many fixed steps' worth as
+        // the step covers, and by at most 2*tol radians.
+        float clear=min(max(max(abs(pos.y)-dt,r-do_),di-r),r-eh);
+        float k=min(max(clear/step,w),max(2.*tol/(g*.5),1.));
+        
         if(dens>.01){
             vec3 c=getColor(pos,r,dens);
             vec3 light=calcLighting(pos,d,dens);
@@ -188,39 +276,24 @@ vec3 march(vec3 o,vec3 d){
             br*=(1.+cos(atan(pos.z,pos.x)*8.-t*3.)*.5);
             
             vec3 dc=c*br*light;
-            float a=dens*.25;
+            float a=min(dens*.25*k,1.);  // the sample stands for the step it starts
             col+=dc*a*(1.-alpha);
             alpha+=a*(1.-alpha);
             if(alpha>.98)break;
         }
         
-        float g=(sr*sr)/(r*r+.006);
-        vec3 gd=-normalize(pos);
-        d=normalize(d+gd*g*.5);
-        
-        float step=.02+r*.01;
-        if(r>di-.7&&r<do_+.7)step*=.3;
+        d=normalize(d+gd*g*.5*k);
+        step*=k;
+        w=k;
         pos+=d*step;
         td+=step;
         if(td>35)break;
     }
     
-    vec3 sd=normalize(d);
-    float sn=h(sd.xy*280+sd.z*150);
-    if(sn>.9978){
-        float sb=(sn-.9978)*2000;
-        vec3 sc=mix(vec3(1.,.96,.88),vec3(.88,.96,1.),h(sd.yz*165));
-        float twinkle=.65+.35*sin(sn*1200.+t*6.);
-        col+=sc*sb*twinkle*(1.-alpha);
-    }
-    
-    float bg=fbm(sd.xy*5.+t*.025)*.05;
-    vec3 nebula=mix(vec3(.06,.03,.1),vec3(.1,.05,.15),bg);
-    nebula+=vec3(.02,.01,.03)*fbm(sd.yz*3.-t*.02);
-    col+=nebula*(1.-alpha);
-    
-    col+=vec3(.0008,.0015,.006)*(1.-alpha);
-    return col;
+    // the march's own bending is too coarse to aim at the sky; the table
+    // says where the ray really goes
+    if(!escapes)return col+vec3(.04,.015,.08)*(1.-alpha);
+    return col+sky(far)*(1.-alpha);
 }
 
 void main(){
@@ -257,6 +330,193 @@ void main(){
 }
 )";
 
+// Noise baked at startup, so the march fetches it instead of hashing.
+// NOISE_2D must match NOISE2 in the shader.
+const int NOISE_2D = 256;
+const int NOISE_3D = 128;
+
+// Integer hash of a lattice point to [0,1)
+float hashTexel(uint32_t x){
+    x ^= x >> 16; x *= 0x7feb352du;
+    x ^= x >> 15; x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+// n()'s lattice values, one texel per point. Repeat wrapping makes the
+// lattice, and so every octave of fbm, tile every NOISE_2D cells.
+GLuint bakeNoise2(){
+    std::vector<uint16_t> px(NOISE_2D*NOISE_2D);
+    for(size_t i=0;i<px.size();i++)
+        px[i]=(uint16_t)(hashTexel((uint32_t)i)*65535.0f);
+    GLuint tex;
+    glGenTextures(1,&tex);
+    glBindTexture(GL_TEXTURE_2D,tex);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_R16,NOISE_2D,NOISE_2D,0,GL_RED,GL_UNSIGNED_SHORT,px.data());
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_REPEAT);
+    return tex;
+}
+
+// fbm3 was four octaves of h3, which has no lattice: white noise at any
+// scale. Each texel holds the same four-octave sum of fresh values, and
+// filtering turns it into grain about a texel, 1/16 of a world unit, across.
+GLuint bakeNoise3(){
+    std::vector<uint16_t> px((size_t)NOISE_3D*NOISE_3D*NOISE_3D);
+    for(size_t i=0;i<px.size();i++){
+        float val=0,amp=.5f;
+        for(uint32_t o=0;o<4;o++){
+            val+=amp*(hashTexel((uint32_t)i*4+o+0x9e3779b9u)-.5f);
+            amp*=.5f;
+        }
+        px[i]=(uint16_t)((val*.5f+.5f)*65535.0f);
+    }
+    GLuint tex;
+    glGenTextures(1,&tex);
+    glBindTexture(GL_TEXTURE_3D,tex);
+    glTexImage3D(GL_TEXTURE_3D,0,GL_R16,NOISE_3D,NOISE_3D,NOISE_3D,0,GL_RED,GL_UNSIGNED_SHORT,px.data());
+    glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_WRAP_S,GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_WRAP_T,GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_WRAP_R,GL_REPEAT);
+    return tex;
+}
+
+// Lensing table. march() turns a ray towards the hole by .5*g per step,
+// so per unit length it turns at kappa(r) = .5*g(r)/step(r), which only
+// depends on r. A ray's fate then only depends on the camera radius R and
+// its angle a from the outward radial, and is integrated here with RK4 in
+// the ray's plane. Texel (i, j): a = PI*(1-(1-u)^2) for u = (i+.5)/LENS_W,
+// denser towards the hole where it matters, and R across [LENS_RMIN,
+// LENS_RMAX]. It holds how far the ray turns before escaping and the
+// closest it comes; below eh it was captured.
+const int LENS_W = 1024;
+const int LENS_H = 64;
+const double LENS_RMIN = 1.0, LENS_RMAX = 6.0;
+const double SR = .12, EH = .18, DI = .35, DO = 4.5;  // as in the shader
+const double LENS_FAR = 100;   // turning left beyond this is below 1e-4 rad
+const double LENS_PATH = 200;  // rays still going after this are orbiting: captured
+const double PI = 3.14159265358979323846;  // M_PI isn't standard C++
+
+double marchStep(double r){
+    double step=.02+r*.01;
+    return r>DI-.7&&r<DO+.7 ? step*.3 : step;
+}
+
+double turnRate(double r){
+    return .5*SR*SR/(r*r+.006)/marchStep(r);
+}
+
+struct Ray { double turn, rmin; };
+
+Ray traceRay(double R,double a){
+    double s[3]={R,0,a};  // x, y, direction angle
+    auto f=[](const double* s,double* ds){
+        double r=std::sqrt(s[0]*s[0]+s[1]*s[1]);
+        ds[0]=std::cos(s[2]);
+        ds[1]=std::sin(s[2]);
+        ds[2]=turnRate(r)*(s[0]*ds[1]-s[1]*ds[0])/r;
+    };
+    double rmin=R;
+    for(double path=0;path<LENS_PATH;){
+        double r=std::sqrt(s[0]*s[0]+s[1]*s[1]);
+        rmin=std::min(rmin,r);
+        if(r<EH) return {s[2]-a,r};
+        if(r>LENS_FAR && s[0]*std::cos(s[2])+s[1]*std::sin(s[2])>0) return {s[2]-a,rmin};
+        // at most .2 rad of turn a step, short next to the hole, and landing on
+        // the edge of the march's fine band where the bending rate jumps
+        double h=std::min(.2/turnRate(r),.25*r);
+        double edge=std::fabs(r-(DO+.7));
+        if(edge<h) h=std::max(edge,1e-4);
+        double k1[3],k2[3],k3[3],k4[3],t[3];
+        f(s,k1);
+        for(int i=0;i<3;i++) t[i]=s[i]+h/2*k1[i];
+        f(t,k2);
+        for(int i=0;i<3;i++) t[i]=s[i]+h/2*k2[i];
+        f(t,k3);
+        for(int i=0;i<3;i++) t[i]=s[i]+h*k3[i];
+        f(t,k4);
+        for(int i=0;i<3;i++) s[i]+=h/6*(k1[i]+2*k2[i]+2*k3[i]+k4[i]);
+        path+=h;
+    }
+    return {s[2]-a,0};
+}
+
+// The shader's own march for the same ray, Euler steps in float, for
+// checking the table against. Returns false if it reaches the horizon.
+bool marchRay(double R,double a,double& dir){
+    float px=(float)R,py=0,dx=(float)std::cos(a),dy=(float)std::sin(a),td=0;
+    for(;;){
+        float r=std::sqrt(px*px+py*py);
+        if(r<(float)EH) return false;
+        float g=(float)(SR*SR)/(r*r+.006f);
+        dx-=px/r*g*.5f; dy-=py/r*g*.5f;
+        float len=std::sqrt(dx*dx+dy*dy);
+        dx/=len; dy/=len;
+        float step=(float)marchStep(r);
+        px+=dx*step; py+=dy*step;
+        td+=step;
+        if(td>35){
+            dir=std::atan2(dy,dx);
+            return true;
+        }
+    }
+}
+
+// How far the shader's march, which lensing used to come from, strays from
+// the table on a sample of its rays (--validate-lensing).
+void checkLensing(const std::vector<float>& px){
+    double worst=0,sum=0;
+    int escaped=0,disagree=0,rays=0;
+    for(int j=0;j<LENS_H;j+=8){
+        double R=LENS_RMIN+(j+.5)/LENS_H*(LENS_RMAX-LENS_RMIN);
+        for(int i=0;i<LENS_W;i+=8){
+            double u=1-(i+.5)/LENS_W,a=PI*(1-u*u),dir;
+            bool escapes=marchRay(R,a,dir);
+            const float* l=&px[2*(j*LENS_W+i)];
+            rays++;
+            if(escapes!=(l[1]>EH)){ disagree++; continue; }
+            if(!escapes) continue;
+            double off=std::fabs(std::remainder(dir-(a+l[0]),2*PI));
+            worst=std::max(worst,off);
+            sum+=off;
+            escaped++;
+        }
+    }
+    std::cout<<"Lensing table: "<<LENS_W<<"x"<<LENS_H<<"; ";
+    if(escaped)
+        std::cout<<"the march strays "<<sum/escaped*180/PI<<" deg on average, "<<worst*180/PI<<" at worst, and ";
+    std::cout<<"disagrees on capture for "<<disagree<<" of "<<rays<<" rays"<<std::endl;
+}
+
+GLuint bakeLensing(bool validate){
+    std::vector<float> px(2*LENS_W*LENS_H);
+    for(int j=0;j<LENS_H;j++){
+        double R=LENS_RMIN+(j+.5)/LENS_H*(LENS_RMAX-LENS_RMIN);
+        for(int i=0;i<LENS_W;i++){
+            double u=1-(i+.5)/LENS_W;
+            Ray ray=traceRay(R,PI*(1-u*u));
+            px[2*(j*LENS_W+i)]=(float)ray.turn;
+            px[2*(j*LENS_W+i)+1]=(float)ray.rmin;
+        }
+    }
+    
+    if(validate) checkLensing(px);
+    
+    GLuint tex;
+    glGenTextures(1,&tex);
+    glBindTexture(GL_TEXTURE_2D,tex);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_RG32F,LENS_W,LENS_H,0,GL_RG,GL_FLOAT,px.data());
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
+    return tex;
+}
+
 GLuint compShader(GLenum type,const char* src){
     GLuint s=glCreateShader(type);
     glShaderSource(s,1,&src,nullptr);
@@ -270,9 +530,35 @@ GLuint compShader(GLenum type,const char* src){
     return s;
 }
 
-GLuint mkProg(){
+// Quality tiers, cheapest first. Each compiles its own variant of frag.
+struct Tier {
+    const char* name;
+    int maxSteps;      // march steps a ray may take
+    int lightSamples;  // shadow steps per lit sample
+    int octaves;       // fbm octaves
+    float tol;         // the march's tol: opacity a step may get wrong, and
+                       // half the radians it may bend the ray
+};
+const Tier TIERS[] = {
+    {"low",    192, 2, 3, .04f},
+    {"medium", 256, 3, 4, .02f},
+    {"high",   256, 4, 6, .01f},
+    {"ultra",  512, 8, 6, .005f},
+};
+const int TIER_COUNT = sizeof(TIERS)/sizeof(TIERS[0]);
+
+// Features that can be turned off whatever the tier
+enum { SHADOWS = 1, STARS = 2, NEBULA = 4, ALL_FEATURES = 7 };
+
+GLuint mkProg(const Tier& tier,int features){
+    char defs[256];
+    snprintf(defs,sizeof(defs),"#version 330 core\n#define MAX_STEPS %d\n#define LIGHT_SAMPLES %d\n"
+             "#define FBM_OCTAVES %d\n#define SHADOWS %d\n#define STARS %d\n#define NEBULA %d\n",
+             tier.maxSteps,tier.lightSamples,tier.octaves,
+             (features&SHADOWS)?1:0,(features&STARS)?1:0,(features&NEBULA)?1:0);
+    std::string src=std::string(defs)+frag;
     GLuint vs=compShader(GL_VERTEX_SHADER,vtx);
-    GLuint fs=compShader(GL_FRAGMENT_SHADER,frag);
+    GLuint fs=compShader(GL_FRAGMENT_SHADER,src.c_str());
     GLuint prog=glCreateProgram();
     glAttachShader(prog,vs);
     glAttachShader(prog,fs);
@@ -287,11 +573,57 @@ GLuint mkProg(){
     return prog;
 }
 
+// --quality auto times frames over AUTO_WINDOW seconds, drops a tier when
+// they average over FRAME_BUDGET, and tries the next one up when they
+// average under half of it
+const double FRAME_BUDGET = 1.0/30;
+const double AUTO_WINDOW = .5;
+
 void fbResize(GLFWwindow* w,int width,int height){
     glViewport(0,0,width,height);
 }
 
-int main(){
+const char* usage =
+    "Usage: blackhole [options]\n"
+    "  --quality TIER        low, medium, high or ultra, or auto to pick one from how long\n"
+    "                        frames take (default auto)\n"
+    "  --no-shadows          don't march towards the light for shadows in the disk\n"
+    "  --no-stars            leave the star field out\n"
+    "  --no-nebula           leave the nebula out\n"
+    "  --validate-lensing    check the lensing table against the shader's march at startup\n";
+
+int main(int argc,char** argv){
+    int tier=2;  // high
+    bool autoQuality=true;
+    int features=ALL_FEATURES;
+    bool validateLensing=false;
+    for(int i=1;i<argc;i++){
+        const char* arg=argv[i];
+        const char* val=i+1<argc?argv[i+1]:nullptr;
+        bool ok=true;
+        if(strcmp(arg,"--quality")==0&&val){
+            autoQuality=strcmp(val,"auto")==0;
+            ok=autoQuality;
+            for(int t=0;t<TIER_COUNT;t++)
+                if(strcmp(val,TIERS[t].name)==0){ tier=t; ok=true; }
+            i++;
+        }else if(strcmp(arg,"--no-shadows")==0){
+            features&=~SHADOWS;
+        }else if(strcmp(arg,"--no-stars")==0){
+            features&=~STARS;
+        }else if(strcmp(arg,"--no-nebula")==0){
+            features&=~NEBULA;
+        }else if(strcmp(arg,"--validate-lensing")==0){
+            validateLensing=true;
+        }else{
+            ok=false;
+        }
+        if(!ok){
+            std::cerr<<"Bad option: "<<arg<<"\n"<<usage;
+            return -1;
+        }
+    }
+    
     if(!glfwInit()){
         std::cerr<<"GLFW init fail"<<std::endl;
         return -1;
@@ -301,7 +633,7 @@ int main(){
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR,3);
     glfwWindowHint(GLFW_OPENGL_PROFILE,GLFW_OPENGL_CORE_PROFILE);
     
-    GLFWwindow* win=glfwCreateWindow(1600,900,"Black Hole - Ultra Quality",nullptr,nullptr);
+    GLFWwindow* win=glfwCreateWindow(1600,900,"Black Hole",nullptr,nullptr);
     if(!win){
         std::cerr<<"Window fail"<<std::endl;
         glfwTerminate();
@@ -342,7 +674,21 @@ int main(){
     glVertexAttribPointer(1,2,GL_FLOAT,GL_FALSE,5*sizeof(float),(void*)(3*sizeof(float)));
     glEnableVertexAttribArray(1);
     
-    GLuint prog=mkProg();
+    // variants are compiled the first time their tier is used
+    GLuint progs[TIER_COUNT]={};
+    auto useTier=[&](int t){
+        if(!progs[t]) progs[t]=mkProg(TIERS[t],features);
+        std::cout<<"Quality: "<<TIERS[t].name<<(autoQuality?" (auto)":"")<<std::endl;
+        glfwSetWindowTitle(win,(std::string("Black Hole - ")+TIERS[t].name+" quality").c_str());
+        tier=t;
+    };
+    useTier(tier);
+    int ceiling=TIER_COUNT-1;  // lowest tier auto found too slow, less one
+    int frames=-1;
+    double windowStart=0;
+    GLuint noise2=bakeNoise2();
+    GLuint noise3=bakeNoise3();
+    GLuint lens=bakeLensing(validateLensing);
     glm::mat4 mdl=glm::mat4(1.0f);
     glm::mat4 view=glm::translate(glm::mat4(1.0f),glm::vec3(0,0,-3));
     
@@ -364,11 +710,22 @@ int main(){
         
         glClearColor(0,0,0,1);
         glClear(GL_COLOR_BUFFER_BIT);
+        GLuint prog=progs[tier];
         glUseProgram(prog);
         
         glUniform1f(glGetUniformLocation(prog,"t"),tm);
         glUniform3f(glGetUniformLocation(prog,"cam"),cx,cy,cz);
         glUniform2f(glGetUniformLocation(prog,"res"),(float)w,(float)h);
+        glUniform1f(glGetUniformLocation(prog,"tol"),TIERS[tier].tol);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D,noise2);
+        glUniform1i(glGetUniformLocation(prog,"noise2"),0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_3D,noise3);
+        glUniform1i(glGetUniformLocation(prog,"noise3"),1);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D,lens);
+        glUniform1i(glGetUniformLocation(prog,"lens"),2);
         glUniformMatrix4fv(glGetUniformLocation(prog,"m"),1,GL_FALSE,glm::value_ptr(mdl));
         glUniformMatrix4fv(glGetUniformLocation(prog,"v"),1,GL_FALSE,glm::value_ptr(view));
         glUniformMatrix4fv(glGetUniformLocation(prog,"p"),1,GL_FALSE,glm::value_ptr(proj));
@@ -377,12 +734,36 @@ int main(){
         glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
         glfwSwapBuffers(win);
         glfwPollEvents();
+        
+        // A tier's first frame pays for compiling it, so timing starts after
+        if(autoQuality){
+            double now=glfwGetTime();
+            if(++frames==0){
+                windowStart=now;
+            }else if(now-windowStart>=AUTO_WINDOW){
+                double frameTime=(now-windowStart)/frames;
+                frames=0;
+                windowStart=now;
+                if(frameTime>FRAME_BUDGET&&tier>0){
+                    ceiling=tier-1;
+                    useTier(tier-1);
+                    frames=-1;
+                }else if(frameTime<FRAME_BUDGET*.5&&tier<ceiling){
+                    useTier(tier+1);
+                    frames=-1;
+                }
+            }
+        }
     }
     
     glDeleteVertexArrays(1,&vao);
     glDeleteBuffers(1,&vbo);
     glDeleteBuffers(1,&ebo);
-    glDeleteProgram(prog);
+    for(GLuint prog:progs)
+        if(prog) glDeleteProgram(prog);
+    glDeleteTextures(1,&noise2);
+    glDeleteTextures(1,&noise3);
+    glDeleteTextures(1,&lens);
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
@@ -24,6 +24,8 @@ switch ($choice) {
         Write-Host "Mousewheel - Zoom In/Zoom Out"
         Write-Host "Left Click - Jump to location"
         Write-Host "R - Reset position"
+        Write-Host "P - Cycle palette"
+        Write-Host "T - Toggle tile cache"
         Write-Host "ESC - Exit`n"
     }
     "3" {
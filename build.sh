@@ -26,6 +26,8 @@ case $choice in
     echo "Mousewheel - Zoom In/Zoom Out"
     echo "Left Click - Jump to location"
     echo "R - Reset position"
+    echo "P - Cycle palette"
+    echo "T - Toggle tile cache"
     echo "ESC - Exit"
     echo ""
     ;;
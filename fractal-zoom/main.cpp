@@ -10,7 +10,49 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <complex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define FRACTAL_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define FRACTAL_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define FRACTAL_TARGET(isa)
+#endif
 
 const char* vtx = R"(
 #version 330 core
@@ -24,37 +66,161 @@ void main() {
 }
 )";
 
-const char* frag = R"(
+// Iteration pass: writes each pixel's smooth escape value into an R32F
+// buffer. It only runs when the view changes; colorFrag reads the result.
+const char* iterFrag = R"(
 #version 330 core
-out vec4 FragColor;
+// `precise` stops the compiler simplifying away df64 error terms and
+// fusing the float tier into fma, which keeps it bit-identical to the CPU
+// renderer. Without the extension the df64 tier isn't used (see g_df64).
+#ifdef GL_ARB_gpu_shader5
+#extension GL_ARB_gpu_shader5 : enable
+#define EXACT precise
+#else
+#define EXACT
+#endif
+out float Iter;
 in vec2 uv;
-uniform float t;
 uniform vec2 res;
-uniform vec2 center;
+uniform vec2 centerHi;  // centre as df64 hi/lo pairs
+uniform vec2 centerLo;
 uniform float zoom;
 uniform int fractalMode;
+uniform int maxIter;
 
-vec3 hsv2rgb(vec3 c){
-    vec4 K=vec4(1,2./3.,1./3.,3);
-    vec3 p=abs(fract(c.xxx+K.xyz)*6-K.www);
-    return c.z*mix(K.xxx,clamp(p-K.xxx,0.,1.),c.y);
+// 0 float, 1 df64, 2 perturbation; see Tier
+uniform int tier;
+
+// perturbation: per-pixel offsets from a reference orbit computed on the CPU
+uniform sampler2D orbit;
+uniform int orbitLen;
+uniform int skip;
+uniform vec2 series[3];
+
+// continuous escape count for a pixel that escaped at step i with |z|^2=r2
+float smoothEscape(int i,float r2){
+    return float(i)+1.-log2(.5*log2(r2));
 }
 
-float mandel(vec2 c,int maxIter){
-    vec2 z=vec2(0);
+// z -> z^2+c from z0. An orbit that lands exactly on an earlier point
+// cycles for good, so it stops there as interior. The point compared
+// against is taken at every power of two steps (Brent), which catches any
+// cycle once the step count passes its period.
+float escape(vec2 z0,vec2 c,int maxIter){
+    EXACT vec2 z=z0;
+    vec2 saved=z0;
     for(int i=0;i<maxIter;i++){
-        float r2=dot(z,z);
-        if(r2>4.)return float(i);
+        EXACT float r2=dot(z,z);
+        if(r2>4.)return smoothEscape(i,r2);
         z=vec2(z.x*z.x-z.y*z.y,2.*z.x*z.y)+c;
+        if(z==saved)return float(maxIter);
+        if((i&(i+1))==0)saved=z;
     }
     return float(maxIter);
 }
 
-float julia(vec2 z,vec2 c,int maxIter){
+// true inside the main cardioid or the period-2 bulb, which hold most of
+// the set's area and would otherwise run all maxIter iterations
+bool inMainBulbs(vec2 c){
+    EXACT float xq=c.x-.25;
+    EXACT float y2=c.y*c.y;
+    EXACT float q=xq*xq+y2;
+    EXACT float card=q*(q+xq);
+    EXACT float bx=c.x+1.;
+    EXACT float bulb=bx*bx+y2;
+    return card<=.25*y2||bulb<=.0625;
+}
+
+float mandel(vec2 c,int maxIter){
+    if(inMainBulbs(c))return float(maxIter);
+    return escape(vec2(0),c,maxIter);
+}
+
+float julia(vec2 z0,vec2 c,int maxIter){
+    return escape(z0,c,maxIter);
+}
+
+// df64: a value carried as the unevaluated sum x+y of two floats, giving
+// about 48 significant bits with plain float arithmetic
+vec2 dfAdd(vec2 a,vec2 b){
+    EXACT float s=a.x+b.x;
+    EXACT float v=s-a.x;
+    EXACT float e=(a.x-(s-v))+(b.x-v)+a.y+b.y;
+    EXACT float h=s+e;
+    EXACT float l=e-(h-s);
+    return vec2(h,l);
+}
+
+vec2 dfSplit(float a){
+    EXACT float t=a*4097.;
+    EXACT float hi=t-(t-a);
+    EXACT float lo=a-hi;
+    return vec2(hi,lo);
+}
+
+vec2 dfMul(vec2 a,vec2 b){
+    EXACT float p=a.x*b.x;
+    vec2 as=dfSplit(a.x),bs=dfSplit(b.x);
+    EXACT float e=((as.x*bs.x-p)+as.x*bs.y+as.y*bs.x)+as.y*bs.y+a.x*b.y+a.y*b.x;
+    EXACT float h=p+e;
+    EXACT float l=e-(h-p);
+    return vec2(h,l);
+}
+
+// escape as above with every component in df64. The bulb test is left
+// out: in float it would misjudge points closer to the boundary than df64
+// pixels are wide.
+float escapeDf(vec2 zx,vec2 zy,vec2 cx,vec2 cy,int maxIter){
+    vec4 saved=vec4(zx,zy);
     for(int i=0;i<maxIter;i++){
+        vec2 x2=dfMul(zx,zx),y2=dfMul(zy,zy);
+        if(x2.x+y2.x>4.)return smoothEscape(i,x2.x+y2.x);
+        vec2 xy=dfMul(zx,zy);
+        zy=dfAdd(dfAdd(xy,xy),cy);
+        zx=dfAdd(x2,dfAdd(cx,-y2));
+        if(vec4(zx,zy)==saved)return float(maxIter);
+        if((i&(i+1))==0)saved=vec4(zx,zy);
+    }
+    return float(maxIter);
+}
+
+vec2 cmul(vec2 a,vec2 b){
+    return vec2(a.x*b.x-a.y*b.y,a.x*b.y+a.y*b.x);
+}
+
+vec2 refZ(int n){
+    int w=textureSize(orbit,0).x;
+    return texelFetch(orbit,ivec2(n%w,n/w),0).xy;
+}
+
+// Iterates dz, the offset of this pixel's orbit from the reference orbit Z,
+// for a pixel p half-heights from the centre. The series covers the first
+// `skip` iterations for every pixel at once. There is no periodicity
+// check: z is only known to float precision around a moving reference, so
+// an exact repeat proves nothing.
+float perturb(vec2 p,int maxIter){
+    vec2 d=p*zoom;
+    vec2 dc=fractalMode==0?d:vec2(0);
+    vec2 dz=fractalMode==0?vec2(0):d;
+    int n=0;
+    if(skip>0){
+        vec2 u=p/length(vec2(res.x/res.y,1));
+        dz=cmul(u,series[0]+cmul(u,series[1]+cmul(u,series[2])));
+        n=skip;
+    }
+    int m=n;
+    for(;n<maxIter;n++){
+        vec2 z=refZ(m)+dz;
         float r2=dot(z,z);
-        if(r2>4.)return float(i);
-        z=vec2(z.x*z.x-z.y*z.y,2.*z.x*z.y)+c;
+        if(r2>4.)return smoothEscape(n,r2);
+        // rebase onto the start of the reference when the orbit passes closer
+        // to zero than to the reference, or the reference has escaped
+        if(r2<dot(dz,dz)||m==orbitLen-1){
+            dz=z-refZ(0);
+            m=0;
+        }
+        dz=cmul(2.*refZ(m)+dz,dz)+dc;
+        m++;
     }
     return float(maxIter);
 }
@@ -63,28 +229,79 @@ void main(){
     vec2 uv_=(uv-.5)*2;
     uv_.x*=res.x/res.y;
     
-    vec2 coord=uv_*zoom+center;
+    vec2 coord=uv_*zoom+centerHi;
     
     float iter;
-    int maxIter=256;
     
-    if(fractalMode==0){
+    if(tier==2){
+        iter=perturb(uv_,maxIter);
+    }else if(tier==1){
+        vec2 d=uv_*zoom;
+        vec2 x=dfAdd(vec2(centerHi.x,centerLo.x),vec2(d.x,0));
+        vec2 y=dfAdd(vec2(centerHi.y,centerLo.y),vec2(d.y,0));
+        if(fractalMode==0)
+            iter=escapeDf(vec2(0),vec2(0),x,y,maxIter);
+        else
+            iter=escapeDf(x,y,vec2(-.4,0),vec2(.6,0),maxIter);
+    }else if(fractalMode==0){
         iter=mandel(coord,maxIter);
     }else{
         vec2 c=vec2(-.4,.6);
         iter=julia(coord,c,maxIter);
     }
     
-    vec3 col;
-    if(iter>=float(maxIter)){
-        col=vec3(0);
-    }else{
-        float n=iter/float(maxIter);
-        float hue=n*.7;
-        col=hsv2rgb(vec3(hue,.8,.9));
-    }
+    Iter=iter;
+}
+)";
+
+// Tile pass: copies cached escape values into the iteration buffer.
+const char* tileFrag = R"(
+#version 330 core
+out float Iter;
+in vec2 uv;
+uniform sampler2DArray tiles;
+uniform int layer;
+uniform float limit;  // the tile's iteration limit
+
+void main(){
+    float iter=texture(tiles,vec3(uv,layer)).r;
+    // keep the interior black under a finer level's higher limit
+    Iter=iter>=limit?1e30:iter;
+}
+)";
+
+// Colour pass: one fetch from the iteration buffer per pixel, so a still
+// view or an animated palette costs next to nothing. A supersampled poster
+// averages a samples x samples block of the buffer into each pixel.
+const char* colorFrag = R"(
+#version 330 core
+out vec4 FragColor;
+uniform sampler2D iters;  // the framebuffer's size times samples
+uniform int maxIter;
+uniform float phase;      // palette rotation
+uniform int samples;
+
+vec3 hsv2rgb(vec3 c){
+    vec4 K=vec4(1,2./3.,1./3.,3);
+    vec3 p=abs(fract(c.xxx+K.xyz)*6-K.www);
+    return c.z*mix(K.xxx,clamp(p-K.xxx,0.,1.),c.y);
+}
+
+vec3 shade(float iter){
+    if(iter>=float(maxIter))return vec3(0);
+    float n=iter/float(maxIter);
+    float hue=n*.7+phase;
+    return hsv2rgb(vec3(hue,.8,.9));
+}
+
+void main(){
+    ivec2 at=ivec2(gl_FragCoord.xy)*samples;
+    vec3 col=vec3(0);
+    for(int y=0;y<samples;y++)
+        for(int x=0;x<samples;x++)
+            col+=shade(texelFetch(iters,at+ivec2(x,y),0).r);
     
-    FragColor=vec4(col,1);
+    FragColor=vec4(col/float(samples*samples),1);
 }
 )";
 
@@ -101,9 +318,9 @@ GLuint compShader(GLenum type,const char* src){
     return s;
 }
 
-GLuint mkProg(){
-    GLuint vs=compShader(GL_VERTEX_SHADER,vtx);
-    GLuint fs=compShader(GL_FRAGMENT_SHADER,frag);
+GLuint mkProg(const char* vsSrc,const char* fsSrc){
+    GLuint vs=compShader(GL_VERTEX_SHADER,vsSrc);
+    GLuint fs=compShader(GL_FRAGMENT_SHADER,fsSrc);
     GLuint prog=glCreateProgram();
     glAttachShader(prog,vs);
     glAttachShader(prog,fs);
@@ -122,14 +339,117 @@ void fbResize(GLFWwindow* w,int width,int height){
     glViewport(0,0,width,height);
 }
 
-float g_zoom = 2.0f;
-float g_centerX = -0.5f;
-float g_centerY = 0.0f;
+// Double-double: the unevaluated sum hi+lo of two doubles, good for about
+// 32 significant digits. Enough to place the view centre at MIN_ZOOM.
+struct dd {
+    double hi, lo;
+    dd(double hi = 0, double lo = 0) : hi(hi), lo(lo) {}
+};
+
+inline dd quickTwoSum(double a, double b) {
+    double s = a + b;
+    return dd(s, b - (s - a));
+}
+
+inline dd operator+(dd a, dd b) {
+    double s = a.hi + b.hi, v = s - a.hi;
+    double e = (a.hi - (s - v)) + (b.hi - v);
+    return quickTwoSum(s, e + a.lo + b.lo);
+}
+
+inline dd operator-(dd a) { return dd(-a.hi, -a.lo); }
+inline dd operator-(dd a, dd b) { return a + -b; }
+
+inline dd& operator+=(dd& a, dd b) { return a = a + b; }
+inline dd& operator-=(dd& a, dd b) { return a = a - b; }
+inline bool operator==(dd a, dd b) { return a.hi == b.hi && a.lo == b.lo; }
+
+inline dd operator*(dd a, dd b) {
+    double p = a.hi * b.hi;
+    double e = std::fma(a.hi, b.hi, -p);
+    return quickTwoSum(p, e + a.hi * b.lo + a.lo * b.hi);
+}
+
+// Long division, a double's worth of quotient at a time
+inline dd operator/(dd a, dd b) {
+    double q1 = a.hi / b.hi;
+    dd r = a - b * q1;
+    double q2 = r.hi / b.hi;
+    r -= b * q2;
+    return quickTwoSum(q1, q2) + r.hi / b.hi;
+}
+
+// Reads a decimal number such as -1.25e-3 to full dd precision, which
+// strtod would round to a double. Returns the end of the number, or
+// nullptr if s doesn't start with one or its exponent is beyond
+// DD_MAX_EXP.
+const int DD_MAX_EXP = 308;  // a double's range, and so a dd's
+
+const char* parseDd(const char* s, dd& out) {
+    bool neg = *s == '-';
+    if(*s == '-' || *s == '+') s++;
+    dd v;
+    int digits = 0, scale = 0;
+    for(bool point = false;; s++) {
+        if(*s == '.' && !point) { point = true; continue; }
+        if(*s < '0' || *s > '9') break;
+        v = v * 10.0 + (double)(*s - '0');
+        digits++;
+        scale -= point;
+    }
+    if(!digits) return nullptr;
+    if(*s == 'e' || *s == 'E') {
+        char* end;
+        long exp = strtol(s + 1, &end, 10);
+        if(end == s + 1 || exp < -DD_MAX_EXP || exp > DD_MAX_EXP) return nullptr;
+        scale += (int)exp;
+        s = end;
+    }
+    if(std::abs(scale) > DD_MAX_EXP) return nullptr;
+    dd p = 1.0;  // powers of ten stay exact in dd up to 1e45
+    for(int i = 0; i < std::abs(scale); i++) p = p * 10.0;
+    v = scale < 0 ? v / p : v * p;
+    out = neg ? -v : v;
+    return s;
+}
+
+// Iteration limit for pixels `pixel` across: BASE_ITER at the top-level
+// view and ITER_PER_OCTAVE more each time pixels halve, since deeper views
+// need longer orbits to resolve. Whole octaves only, so tiles of one level
+// and views at about their scale agree.
+const int BASE_ITER = 128;
+const int ITER_PER_OCTAVE = 64;
+const int ITER_CAP = 16384;
+const double BASE_PIXEL = 1.0 / 128;
+
+int g_maxIter = 0;  // --max-iter; 0 picks it from the pixel size
+
+int iterLimit(double pixel) {
+    if(g_maxIter) return g_maxIter;
+    double octaves = std::max(0.0, std::floor(std::log2(BASE_PIXEL / pixel)));
+    return (int)std::min<double>(ITER_CAP, BASE_ITER + ITER_PER_OCTAVE * octaves);
+}
+
+// Precision tiers, chosen by zoom. Float coordinates run out below
+// DF64_ZOOM; df64 keeps the per-pixel cost fixed and needs no CPU work
+// down to DEEP_ZOOM, with its 48 bits still ~100x finer than a pixel there.
+enum Tier { TIER_FLOAT, TIER_DF64, TIER_PERTURB };
+const double DF64_ZOOM = 1e-4;
+const double DEEP_ZOOM = 1e-10;
+// df64 needs `precise` (GL_ARB_gpu_shader5): without it the driver is free
+// to fold its error terms away, and does, so perturbation covers the range.
+bool g_df64 = false;
+const double MIN_ZOOM = 1e-30;  // float pixel offsets stay normal down to here
+const double JULIA_CX = -0.4f, JULIA_CY = 0.6f;  // exactly the shader's float julia constant
+
+double g_zoom = 2.0;
+dd g_centerX = -0.5;
+dd g_centerY = 0.0;
 int g_mode = 0;
 
 void scroll_callback(GLFWwindow* w, double xoff, double yoff) {
-    g_zoom *= (yoff > 0) ? 0.9f : 1.1f;
-    g_zoom = fmax(0.0001f, g_zoom);
+    g_zoom *= (yoff > 0) ? 0.9 : 1.1;
+    g_zoom = fmax(MIN_ZOOM, g_zoom);
 }
 
 void mouse_button_callback(GLFWwindow* w, int button, int action, int mods) {
@@ -139,15 +459,1404 @@ void mouse_button_callback(GLFWwindow* w, int button, int action, int mods) {
         int ww, wh;
         glfwGetWindowSize(w, &ww, &wh);
         
-        float nx = (mx / ww - 0.5f) * 2.0f * (float)ww / (float)wh;
-        float ny = -(my / wh - 0.5f) * 2.0f;
+        double nx = (mx / ww - 0.5) * 2.0 * (double)ww / (double)wh;
+        double ny = -(my / wh - 0.5) * 2.0;
         
         g_centerX += nx * g_zoom;
         g_centerY += ny * g_zoom;
     }
 }
 
-int main(){
+// Deep zoom renders by perturbation: one reference orbit at the view centre
+// is iterated in double-double here, and the shader only iterates each
+// pixel's small offset from it in float. A cubic series in the pixel offset
+// stands in for the first `skip` iterations, which every pixel then skips.
+// The coefficients are scaled by the view radius so they fit in a float.
+const int ORBIT_WIDTH = 1024;     // texels per row of the orbit texture
+const double SERIES_TOL = 1e-5;   // allowed series error, relative to the linear term
+
+struct DeepView {
+    GLuint tex = 0;
+    std::vector<float> orbit;     // Z_n as float pairs
+    int len = 0;
+    int skip = 0;
+    float series[6] = {};
+    
+    // view the orbit was built for
+    dd cx = 1e300, cy;
+    double radius = 0;
+    int mode = -1, maxIter = 0;
+};
+
+void updateDeepView(DeepView& v, double radius, int maxIter) {
+    if(v.cx == g_centerX && v.cy == g_centerY && v.radius == radius && v.mode == g_mode && v.maxIter == maxIter)
+        return;
+    v.cx = g_centerX; v.cy = g_centerY; v.radius = radius; v.mode = g_mode; v.maxIter = maxIter;
+    
+    typedef std::complex<double> cd;
+    bool julia = g_mode != 0;
+    dd zx = julia ? g_centerX : 0, zy = julia ? g_centerY : 0;
+    dd cx = julia ? JULIA_CX : g_centerX, cy = julia ? JULIA_CY : g_centerY;
+    std::vector<cd> z;
+    for(int n = 0; n < maxIter; n++) {
+        z.push_back(cd(zx.hi, zy.hi));
+        if(std::norm(z.back()) > 4) break;
+        dd x2 = zx * zx, y2 = zy * zy, xy = zx * zy;
+        zx = x2 - y2 + cx;
+        zy = xy + xy + cy;
+    }
+    v.len = (int)z.size();
+    
+    // dz_n ~ a u + b u^2 + c u^3 for the pixel offset u in view radii
+    cd a = julia ? radius : 0, b = 0, c = 0;
+    v.skip = 0;
+    for(int n = 0; n + 1 < v.len; n++) {
+        cd a2 = 2.0 * z[n] * a + (julia ? 0 : radius);
+        cd b2 = 2.0 * z[n] * b + a * a;
+        cd c2 = 2.0 * z[n] * c + 2.0 * a * b;
+        // stop before the dropped terms, estimated as c^2/b, become visible or
+        // some pixel could escape within the skipped iterations
+        if(std::norm(c2) * std::norm(c2) > SERIES_TOL * SERIES_TOL * std::norm(a2) * std::norm(b2)) break;
+        if(std::abs(z[n + 1]) + std::abs(a2) + std::abs(b2) + std::abs(c2) > 2) break;
+        a = a2; b = b2; c = c2;
+        v.skip = n + 1;
+    }
+    cd coef[3] = {a, b, c};
+    for(int i = 0; i < 3; i++) {
+        v.series[2 * i] = (float)coef[i].real();
+        v.series[2 * i + 1] = (float)coef[i].imag();
+    }
+    
+    int rows = (v.len + ORBIT_WIDTH - 1) / ORBIT_WIDTH;
+    v.orbit.assign(2 * ORBIT_WIDTH * rows, 0.0f);
+    for(int n = 0; n < v.len; n++) {
+        v.orbit[2 * n] = (float)z[n].real();
+        v.orbit[2 * n + 1] = (float)z[n].imag();
+    }
+    if(!v.tex) {
+        glGenTextures(1, &v.tex);
+        glBindTexture(GL_TEXTURE_2D, v.tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, v.tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, ORBIT_WIDTH, rows, 0, GL_RG, GL_FLOAT, v.orbit.data());
+}
+
+// CPU renderer. It reproduces the shader's float tier pixel for pixel:
+// the same coordinate mapping, iteration and colouring, computed 8 or 16
+// pixels at a time. A SIMD lane whose pixel escapes is refilled with the
+// next pixel of its list at once, so escaped pixels stop costing
+// iterations. Views too deep for float fall back to scalar doubles.
+const int CPU_TILE = 32;
+
+struct EscapeJob {
+    int width, height;
+    int mode, maxIter;
+    bool wide;                      // iterate in double
+    std::vector<float> xs, ys;      // pixel centre coordinates, per column and row
+    std::vector<double> xd, yd;
+    std::vector<float> iters;       // smooth escape value per pixel, top row first
+};
+
+// The shader's smoothEscape
+static float smoothEscape(int i, float r2) {
+    return (float)i + 1.0f - std::log2(0.5f * std::log2(r2));
+}
+
+// The shader's inMainBulbs, in the same order of operations
+template<class T>
+static bool inMainBulbs(T cx, T cy) {
+    T xq = cx - (T)0.25, y2 = cy * cy;
+    T q = xq * xq + y2;
+    T bx = cx + 1;
+    return q * (q + xq) <= (T)0.25 * y2 || bx * bx + y2 <= (T)0.0625;
+}
+
+struct Tile { int x0, y0, x1, y1; };
+
+EscapeJob makeEscapeJob(int width, int height) {
+    EscapeJob job;
+    job.width = width; job.height = height;
+    job.mode = g_mode; job.maxIter = iterLimit(2.0 * g_zoom / height);
+    job.wide = g_zoom < DF64_ZOOM;
+    job.iters.resize((size_t)width * height);
+    // as in the shader: uv_=(uv-.5)*2, uv_.x*=res.x/res.y, coord=uv_*zoom+center
+    float asp = (float)width / (float)height, zoom = (float)g_zoom;
+    float cx = (float)g_centerX.hi, cy = (float)g_centerY.hi;
+    for(int x = 0; x < width; x++) {
+        float u = ((x + 0.5f) / width - 0.5f) * 2.0f * asp;
+        job.xs.push_back(u * zoom + cx);
+        job.xd.push_back((((x + 0.5) / width - 0.5) * 2.0 * width / height * g_zoom + g_centerX).hi);
+    }
+    for(int y = 0; y < height; y++) {
+        float v = ((height - 1 - y + 0.5f) / height - 0.5f) * 2.0f;
+        job.ys.push_back(v * zoom + cy);
+        job.yd.push_back(((0.5 - (y + 0.5) / height) * 2.0 * g_zoom + g_centerY).hi);
+    }
+    return job;
+}
+
+template<class T> const T* columnCoords(const EscapeJob& job);
+template<> const float* columnCoords<float>(const EscapeJob& job) { return job.xs.data(); }
+template<> const double* columnCoords<double>(const EscapeJob& job) { return job.xd.data(); }
+template<class T> const T* rowCoords(const EscapeJob& job);
+template<> const float* rowCoords<float>(const EscapeJob& job) { return job.ys.data(); }
+template<> const double* rowCoords<double>(const EscapeJob& job) { return job.yd.data(); }
+
+template<class T>
+static void escapeScalar(EscapeJob& job, const int* pixels, int count) {
+    const T* xs = columnCoords<T>(job);
+    const T* ys = rowCoords<T>(job);
+    T jx = (T)JULIA_CX, jy = (T)JULIA_CY;
+    for(int k = 0; k < count; k++) {
+        int at = pixels[k];
+        T zx = 0, zy = 0, cx = xs[at % job.width], cy = ys[at / job.width];
+        if(job.mode != 0) { zx = cx; zy = cy; cx = jx; cy = jy; }
+        float iter = (float)job.maxIter;
+        T sx = zx, sy = zy;
+        bool inside = job.mode == 0 && inMainBulbs(cx, cy);
+        for(int i = 0; i < job.maxIter && !inside; i++) {
+            T x2 = zx * zx, y2 = zy * zy;
+            if(x2 + y2 > 4) { iter = smoothEscape(i, (float)(x2 + y2)); break; }
+            zy = (zx + zx) * zy + cy;
+            zx = x2 - y2 + cx;
+            if(zx == sx && zy == sy) break;
+            if((i & (i + 1)) == 0) { sx = zx; sy = zy; }
+        }
+        job.iters[at] = iter;
+    }
+}
+
+// Per-lane state of a SIMD kernel, spilled whenever a lane finishes.
+template<int N>
+struct Lanes {
+    alignas(64) float zx[N], zy[N], cx[N], cy[N], n[N];
+    alignas(64) float sx[N], sy[N], save[N];   // Brent's saved point and when to move it
+    int pixel[N];
+    int next = 0;
+    
+    // Writes out each finished lane in `done` and starts the next pixel of
+    // the list in it, settling pixels in the main bulbs on the way. Lanes
+    // left without work are parked where they never finish. Returns false
+    // once every lane is parked.
+    bool refill(EscapeJob& job, const int* pixels, int count, unsigned done) {
+        bool live = false;
+        for(int i = 0; i < N; i++) {
+            if(done & (1u << i)) {
+                if(pixel[i] >= 0)
+                    job.iters[pixel[i]] = n[i] >= (float)job.maxIter ? n[i] :
+                        smoothEscape((int)n[i], zx[i] * zx[i] + zy[i] * zy[i]);
+                pixel[i] = -1;
+                zx[i] = zy[i] = cx[i] = cy[i] = n[i] = 0;
+                sx[i] = sy[i] = NAN;
+                save[i] = INFINITY;
+                while(next < count) {
+                    int at = pixels[next++];
+                    float x = job.xs[at % job.width], y = job.ys[at / job.width];
+                    if(job.mode == 0 && inMainBulbs(x, y)) {
+                        job.iters[at] = (float)job.maxIter;
+                        continue;
+                    }
+                    if(job.mode == 0) { cx[i] = x; cy[i] = y; }
+                    else { zx[i] = x; zy[i] = y; cx[i] = (float)JULIA_CX; cy[i] = (float)JULIA_CY; }
+                    sx[i] = zx[i]; sy[i] = zy[i]; save[i] = 1;
+                    pixel[i] = at;
+                    break;
+                }
+            }
+            live |= pixel[i] >= 0;
+        }
+        return live;
+    }
+};
+
+#ifdef FRACTAL_X86
+FRACTAL_TARGET("avx2")
+static void escapeAvx2(EscapeJob& job, const int* pixels, int count) {
+    Lanes<8> l;
+    std::fill(l.pixel, l.pixel + 8, -1);
+    if(!l.refill(job, pixels, count, 0xff)) return;
+    __m256 zx = _mm256_load_ps(l.zx), zy = _mm256_load_ps(l.zy);
+    __m256 cx = _mm256_load_ps(l.cx), cy = _mm256_load_ps(l.cy), n = _mm256_load_ps(l.n);
+    __m256 sx = _mm256_load_ps(l.sx), sy = _mm256_load_ps(l.sy), save = _mm256_load_ps(l.save);
+    const __m256 four = _mm256_set1_ps(4.0f), one = _mm256_set1_ps(1.0f);
+    const __m256 limit = _mm256_set1_ps((float)job.maxIter);
+    for(;;) {
+        __m256 x2 = _mm256_mul_ps(zx, zx), y2 = _mm256_mul_ps(zy, zy);
+        __m256 done = _mm256_or_ps(_mm256_cmp_ps(_mm256_add_ps(x2, y2), four, _CMP_GT_OQ),
+                                   _mm256_cmp_ps(n, limit, _CMP_GE_OQ));
+        unsigned bits = (unsigned)_mm256_movemask_ps(done);
+        if(bits) {
+            _mm256_store_ps(l.zx, zx); _mm256_store_ps(l.zy, zy);
+            _mm256_store_ps(l.cx, cx); _mm256_store_ps(l.cy, cy); _mm256_store_ps(l.n, n);
+            _mm256_store_ps(l.sx, sx); _mm256_store_ps(l.sy, sy); _mm256_store_ps(l.save, save);
+            if(!l.refill(job, pixels, count, bits)) return;
+            zx = _mm256_load_ps(l.zx); zy = _mm256_load_ps(l.zy);
+            cx = _mm256_load_ps(l.cx); cy = _mm256_load_ps(l.cy); n = _mm256_load_ps(l.n);
+            sx = _mm256_load_ps(l.sx); sy = _mm256_load_ps(l.sy); save = _mm256_load_ps(l.save);
+            continue;
+        }
+        zy = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(zx, zx), zy), cy);
+        zx = _mm256_add_ps(_mm256_sub_ps(x2, y2), cx);
+        n = _mm256_add_ps(n, one);
+        // a lane back on its saved point is cycling: finish it as interior
+        __m256 cycled = _mm256_and_ps(_mm256_cmp_ps(zx, sx, _CMP_EQ_OQ), _mm256_cmp_ps(zy, sy, _CMP_EQ_OQ));
+        n = _mm256_blendv_ps(n, limit, cycled);
+        __m256 take = _mm256_cmp_ps(n, save, _CMP_EQ_OQ);
+        sx = _mm256_blendv_ps(sx, zx, take);
+        sy = _mm256_blendv_ps(sy, zy, take);
+        save = _mm256_blendv_ps(save, _mm256_add_ps(save, save), take);
+    }
+}
+
+FRACTAL_TARGET("avx512f")
+static void escapeAvx512(EscapeJob& job, const int* pixels, int count) {
+    Lanes<16> l;
+    std::fill(l.pixel, l.pixel + 16, -1);
+    if(!l.refill(job, pixels, count, 0xffff)) return;
+    __m512 zx = _mm512_load_ps(l.zx), zy = _mm512_load_ps(l.zy);
+    __m512 cx = _mm512_load_ps(l.cx), cy = _mm512_load_ps(l.cy), n = _mm512_load_ps(l.n);
+    __m512 sx = _mm512_load_ps(l.sx), sy = _mm512_load_ps(l.sy), save = _mm512_load_ps(l.save);
+    const __m512 four = _mm512_set1_ps(4.0f), one = _mm512_set1_ps(1.0f);
+    const __m512 limit = _mm512_set1_ps((float)job.maxIter);
+    for(;;) {
+        __m512 x2 = _mm512_mul_ps(zx, zx), y2 = _mm512_mul_ps(zy, zy);
+        unsigned bits = _mm512_cmp_ps_mask(_mm512_add_ps(x2, y2), four, _CMP_GT_OQ) |
+                        _mm512_cmp_ps_mask(n, limit, _CMP_GE_OQ);
+        if(bits) {
+            _mm512_store_ps(l.zx, zx); _mm512_store_ps(l.zy, zy);
+            _mm512_store_ps(l.cx, cx); _mm512_store_ps(l.cy, cy); _mm512_store_ps(l.n, n);
+            _mm512_store_ps(l.sx, sx); _mm512_store_ps(l.sy, sy); _mm512_store_ps(l.save, save);
+            if(!l.refill(job, pixels, count, bits)) return;
+            zx = _mm512_load_ps(l.zx); zy = _mm512_load_ps(l.zy);
+            cx = _mm512_load_ps(l.cx); cy = _mm512_load_ps(l.cy); n = _mm512_load_ps(l.n);
+            sx = _mm512_load_ps(l.sx); sy = _mm512_load_ps(l.sy); save = _mm512_load_ps(l.save);
+            continue;
+        }
+        zy = _mm512_add_ps(_mm512_mul_ps(_mm512_add_ps(zx, zx), zy), cy);
+        zx = _mm512_add_ps(_mm512_sub_ps(x2, y2), cx);
+        n = _mm512_add_ps(n, one);
+        __mmask16 cycled = _mm512_cmp_ps_mask(zx, sx, _CMP_EQ_OQ) & _mm512_cmp_ps_mask(zy, sy, _CMP_EQ_OQ);
+        n = _mm512_mask_blend_ps(cycled, n, limit);
+        __mmask16 take = _mm512_cmp_ps_mask(n, save, _CMP_EQ_OQ);
+        sx = _mm512_mask_blend_ps(take, sx, zx);
+        sy = _mm512_mask_blend_ps(take, sy, zy);
+        save = _mm512_mask_add_ps(save, take, save, save);
+    }
+}
+
+static bool cpuHasAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool cpuHasAvx512f() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesZmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0xe6) == 0xe6;
+    __cpuidex(info, 7, 0);
+    return osSavesZmm && (info[1] & (1 << 16)) != 0;
+#else
+    return __builtin_cpu_supports("avx512f");
+#endif
+}
+#endif
+
+// Renders a list of pixels, given as offsets into job.iters.
+typedef void (*EscapeKernel)(EscapeJob& job, const int* pixels, int count);
+
+struct EscapeKernelChoice {
+    const char* name;
+    EscapeKernel fn;
+};
+
+static EscapeKernelChoice pickEscapeKernel(bool wide) {
+    if(wide) return {"scalar double", escapeScalar<double>};
+#ifdef FRACTAL_X86
+    if(cpuHasAvx512f()) return {"AVX-512", escapeAvx512};
+    if(cpuHasAvx2()) return {"AVX2", escapeAvx2};
+#endif
+    return {"scalar", escapeScalar<float>};
+}
+
+// Runs fn(i) for every i in [0, count) on `threads` threads. Each thread
+// starts on its own contiguous block and, when that runs out, steals the
+// back half of the block with the most left. A block is one atomic word,
+// begin in the high half and end in the low, so taking and stealing are
+// single compare-exchanges.
+void forEachStealing(int count, int threads, const std::function<void(int)>& fn) {
+    struct alignas(64) Block { std::atomic<uint64_t> range; };
+    auto pack = [](uint64_t b, uint64_t e) { return b << 32 | e; };
+    std::vector<Block> blocks(threads);
+    for(int i = 0; i < threads; i++)
+        blocks[i].range = pack((uint64_t)count * i / threads, (uint64_t)count * (i + 1) / threads);
+    
+    auto work = [&](int self) {
+        for(;;) {
+            uint64_t r = blocks[self].range.load();
+            while((r >> 32) < (uint32_t)r) {
+                if(blocks[self].range.compare_exchange_weak(r, r + (1ull << 32)))
+                    fn((int)(r >> 32));
+            }
+            
+            int victim = -1;
+            uint32_t most = 0;
+            for(int i = 0; i < threads; i++) {
+                uint64_t v = blocks[i].range.load();
+                uint32_t left = (uint32_t)v - (uint32_t)(v >> 32);
+                if(left > most) { most = left; victim = i; }
+            }
+            if(victim < 0) return;
+            
+            uint64_t v = blocks[victim].range.load();
+            uint32_t b = (uint32_t)(v >> 32), e = (uint32_t)v;
+            if(b >= e) continue;
+            uint32_t mid = b + (e - b) / 2;
+            if(blocks[victim].range.compare_exchange_strong(v, pack(b, mid)))
+                blocks[self].range = pack(mid, e);
+        }
+    };
+    
+    std::vector<std::thread> helpers;
+    for(int i = 1; i < threads; i++) helpers.emplace_back(work, i);
+    work(0);
+    for(auto& t : helpers) t.join();
+}
+
+// Mariani-Silver subdivision (--subdivide). The points still bounded after
+// maxIter iterations form a set without holes, so a rectangle whose border
+// is all interior is interior throughout and gets filled without
+// iterating. Smooth escape values never agree along a border, so escaped
+// bands are always iterated.
+bool g_subdivide = false;
+const int SUBDIVIDE_TILE = 128;   // root rectangles; bigger ones skip more
+const int SUBDIVIDE_MIN = 8;      // rectangles this small are iterated per pixel
+const int SUBDIVIDE_SHARE = 8;    // 1/this of the root borders must be interior
+
+// Appends the offsets of t's pixels, row by row.
+static void addPixels(const EscapeJob& job, const Tile& t, std::vector<int>& out) {
+    for(int y = t.y0; y < t.y1; y++)
+        for(int x = t.x0; x < t.x1; x++)
+            out.push_back(y * job.width + x);
+}
+
+// Appends the offsets of t's border pixels.
+static void addBorder(const EscapeJob& job, const Tile& t, std::vector<int>& out) {
+    addPixels(job, Tile{t.x0, t.y0, t.x1, t.y0 + 1}, out);
+    if(t.y1 - t.y0 > 1) addPixels(job, Tile{t.x0, t.y1 - 1, t.x1, t.y1}, out);
+    addPixels(job, Tile{t.x0, t.y0 + 1, t.x0 + 1, t.y1 - 1}, out);
+    if(t.x1 - t.x0 > 1) addPixels(job, Tile{t.x1 - 1, t.y0 + 1, t.x1, t.y1 - 1}, out);
+}
+
+// How many of t's border pixels are interior. t is at least 2 by 2, so
+// its border has borderSize(t) of them.
+static int borderInside(const EscapeJob& job, const Tile& t) {
+    const float inside = (float)job.maxIter;
+    const float* top = &job.iters[(size_t)t.y0 * job.width];
+    const float* bottom = &job.iters[(size_t)(t.y1 - 1) * job.width];
+    int n = 0;
+    for(int x = t.x0; x < t.x1; x++)
+        n += (top[x] >= inside) + (bottom[x] >= inside);
+    for(int y = t.y0 + 1; y < t.y1 - 1; y++) {
+        const float* row = &job.iters[(size_t)y * job.width];
+        n += (row[t.x0] >= inside) + (row[t.x1 - 1] >= inside);
+    }
+    return n;
+}
+
+static int borderSize(const Tile& t) { return 2 * (t.x1 - t.x0 + t.y1 - t.y0) - 4; }
+
+// Renders the inside of t with kernel by subdivision, t's own border being
+// iterated already. Subdivision works a level at a time: every rectangle
+// of the level is filled, left to be iterated whole, or split across its
+// longer side by a line both halves share, and the pixels the level needs
+// go to the kernel in one list so its SIMD lanes stay busy. Returns the
+// number of pixels iterated.
+size_t renderRect(EscapeJob& job, EscapeKernel kernel, const Tile& t) {
+    std::vector<int> pixels;
+    size_t iterated = 0;
+    std::vector<Tile> level = {t}, next;
+    while(!level.empty() || !pixels.empty()) {
+        if(!pixels.empty()) kernel(job, pixels.data(), (int)pixels.size());
+        iterated += pixels.size();
+        pixels.clear();
+        next.clear();
+        for(const Tile& r : level) {
+            Tile in{r.x0 + 1, r.y0 + 1, r.x1 - 1, r.y1 - 1};
+            if(in.x0 >= in.x1 || in.y0 >= in.y1) continue;
+            int w = r.x1 - r.x0, h = r.y1 - r.y0;
+            if(borderInside(job, r) == borderSize(r)) {
+                for(int y = in.y0; y < in.y1; y++) {
+                    float* row = &job.iters[(size_t)y * job.width];
+                    std::fill(row + in.x0, row + in.x1, (float)job.maxIter);
+                }
+            } else if(std::max(w, h) <= SUBDIVIDE_MIN) {
+                addPixels(job, in, pixels);
+            } else if(w >= h) {
+                int mid = r.x0 + w / 2;
+                addPixels(job, Tile{mid, in.y0, mid + 1, in.y1}, pixels);
+                next.push_back(Tile{r.x0, r.y0, mid + 1, r.y1});
+                next.push_back(Tile{mid, r.y0, r.x1, r.y1});
+            } else {
+                int mid = r.y0 + h / 2;
+                addPixels(job, Tile{in.x0, mid, in.x1, mid + 1}, pixels);
+                next.push_back(Tile{r.x0, r.y0, r.x1, mid + 1});
+                next.push_back(Tile{r.x0, mid, r.x1, r.y1});
+            }
+        }
+        level.swap(next);
+    }
+    return iterated;
+}
+
+// The job cut into size-pixel squares, row by row.
+static std::vector<Tile> cutTiles(const EscapeJob& job, int size) {
+    std::vector<Tile> tiles;
+    for(int y = 0; y < job.height; y += size)
+        for(int x = 0; x < job.width; x += size)
+            tiles.push_back(Tile{x, y, std::min(x + size, job.width), std::min(y + size, job.height)});
+    return tiles;
+}
+
+// Returns the number of pixels iterated. Under --subdivide the root
+// rectangles' borders are iterated first, and subdivision only goes ahead
+// if at least 1/SUBDIVIDE_SHARE of them is interior. With less, as in the
+// default view (5%) or the default Julia set (1%), the fills save less
+// than the split lines cost, and the image is rendered plainly after all.
+// Iterating the borders again costs less than leaving them out pixel by
+// pixel.
+size_t renderCpu(EscapeJob& job, EscapeKernel kernel, int threads) {
+    std::atomic<size_t> iterated(0);
+    if(g_subdivide) {
+        std::vector<Tile> roots = cutTiles(job, SUBDIVIDE_TILE);
+        std::atomic<int> border(0), inside(0);
+        forEachStealing((int)roots.size(), threads, [&](int i) {
+            const Tile& t = roots[i];
+            std::vector<int> pixels;
+            addBorder(job, t, pixels);
+            kernel(job, pixels.data(), (int)pixels.size());
+            iterated += pixels.size();
+            if(t.x1 - t.x0 < 2 || t.y1 - t.y0 < 2) return;
+            border += borderSize(t);
+            inside += borderInside(job, t);
+        });
+        if(inside * SUBDIVIDE_SHARE >= border) {
+            forEachStealing((int)roots.size(), threads, [&](int i) {
+                iterated += renderRect(job, kernel, roots[i]);
+            });
+            return iterated;
+        }
+    }
+    
+    std::vector<Tile> tiles = cutTiles(job, CPU_TILE);
+    forEachStealing((int)tiles.size(), threads, [&](int i) {
+        std::vector<int> pixels;
+        addPixels(job, tiles[i], pixels);
+        kernel(job, pixels.data(), (int)pixels.size());
+        iterated += pixels.size();
+    });
+    return iterated;
+}
+
+static float fract(float x) { return x - std::floor(x); }
+
+// The shader's colouring: hsv2rgb(vec3(n*.7,.8,.9)), black inside the set.
+void colorize(float iter, int maxIter, unsigned char* rgb) {
+    if(iter >= (float)maxIter) { rgb[0] = rgb[1] = rgb[2] = 0; return; }
+    float h = iter / (float)maxIter * 0.7f, s = 0.8f, v = 0.9f;
+    const float K[4] = {1.0f, 2.0f / 3.0f, 1.0f / 3.0f, 3.0f};
+    for(int i = 0; i < 3; i++) {
+        float p = std::fabs(fract(h + K[i]) * 6.0f - K[3]);
+        float c = v * (K[0] * (1.0f - s) + std::min(std::max(p - K[0], 0.0f), 1.0f) * s);
+        rgb[i] = (unsigned char)std::lround(std::min(std::max(c, 0.0f), 1.0f) * 255.0f);
+    }
+}
+
+bool writePpm(const char* path, const EscapeJob& job) {
+    FILE* f = fopen(path, "wb");
+    if(!f) return false;
+    fprintf(f, "P6\n%d %d\n255\n", job.width, job.height);
+    std::vector<unsigned char> row(3 * job.width);
+    for(int y = 0; y < job.height; y++) {
+        for(int x = 0; x < job.width; x++)
+            colorize(job.iters[(size_t)y * job.width + x], job.maxIter, &row[3 * x]);
+        fwrite(row.data(), 1, row.size(), f);
+    }
+    return fclose(f) == 0;
+}
+
+// Escape values rendered by the iteration pass, in screen pixels. Two
+// buffers, so a pan can shift the old values across into the other one.
+struct IterBuffer {
+    GLuint fbo[2] = {}, tex[2] = {};
+    int cur = 0;                  // the buffer holding the view below
+    int w = 0, h = 0;
+    
+    dd cx = 1e300, cy;
+    double zoom = 0;
+    int mode = -1;
+    bool fromTiles = false;       // composed from the tile cache
+};
+
+// Sizes both buffers to w x h. Returns true if they were reallocated.
+bool resizeIterBuffer(IterBuffer& b, int w, int h) {
+    if(!b.fbo[0]) {
+        glGenFramebuffers(2, b.fbo);
+        glGenTextures(2, b.tex);
+        for(int i = 0; i < 2; i++) {
+            glBindTexture(GL_TEXTURE_2D, b.tex[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+    }
+    if(b.w == w && b.h == h) return false;
+    b.w = w; b.h = h;
+    for(int i = 0; i < 2; i++) {
+        glBindTexture(GL_TEXTURE_2D, b.tex[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, nullptr);
+        glBindFramebuffer(GL_FRAMEBUFFER, b.fbo[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, b.tex[i], 0);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+// Brings the buffer to the current view and returns the rectangles that
+// still need an iteration pass. A pixel measures pixelX by pixelY in the
+// fractal and `quad` bounds the pixels the quad covers. When the centre
+// moved by whole pixels the old values are shifted and only the exposed
+// strips are returned; any other change returns the whole buffer.
+std::vector<Tile> updateIterBuffer(IterBuffer& b, int w, int h, double pixelX, double pixelY, const Tile& quad) {
+    std::vector<Tile> dirty;
+    if(!resizeIterBuffer(b, w, h) && !b.fromTiles && b.zoom == g_zoom && b.mode == g_mode) {
+        if(b.cx == g_centerX && b.cy == g_centerY) return dirty;
+        // new pixel (x,y) shows old pixel (x+n,y+m)
+        double sx = (g_centerX - b.cx).hi / pixelX, sy = (g_centerY - b.cy).hi / pixelY;
+        int qw = quad.x1 - quad.x0, qh = quad.y1 - quad.y0;
+        if(std::fabs(sx) < qw && std::fabs(sy) < qh) {
+            int n = (int)std::lround(sx), m = (int)std::lround(sy);
+            if(std::fabs(sx - n) < 1e-3 && std::fabs(sy - m) < 1e-3) {
+                int next = 1 - b.cur;
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, b.fbo[b.cur]);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, b.fbo[next]);
+                glBlitFramebuffer(std::max(0, n), std::max(0, m), w + std::min(0, n), h + std::min(0, m),
+                                  std::max(0, -n), std::max(0, -m), w + std::min(0, -n), h + std::min(0, -m),
+                                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                b.cur = next;
+                // a pixel's slack either side of the strips covers the quad's
+                // partly covered edge pixels
+                if(n > 0) dirty.push_back({std::max(0, quad.x1 - n - 1), 0, w, h});
+                if(n < 0) dirty.push_back({0, 0, quad.x0 - n + 1, h});
+                if(m > 0) dirty.push_back({0, std::max(0, quad.y1 - m - 1), w, h});
+                if(m < 0) dirty.push_back({0, 0, w, quad.y0 - m + 1});
+            }
+        }
+    }
+    if(dirty.empty()) dirty.push_back({0, 0, w, h});
+    b.cx = g_centerX; b.cy = g_centerY; b.zoom = g_zoom; b.mode = g_mode;
+    b.fromTiles = false;
+    return dirty;
+}
+
+// As updateIterBuffer for a view drawn from the tile cache: returns true
+// if the buffer does not hold this view yet.
+bool updateTiledBuffer(IterBuffer& b, int w, int h) {
+    bool stale = resizeIterBuffer(b, w, h) || !b.fromTiles ||
+                 !(b.cx == g_centerX && b.cy == g_centerY && b.zoom == g_zoom && b.mode == g_mode);
+    b.cx = g_centerX; b.cy = g_centerY; b.zoom = g_zoom; b.mode = g_mode;
+    b.fromTiles = true;
+    return stale;
+}
+
+// Tile cache. The plane is cut into a quadtree of CACHE_TILE-pixel square
+// tiles, those of level L spanning TILE_SPAN0/2^L (L goes negative when
+// zoomed far out), and computed tiles are kept so a revisited region is
+// drawn straight from memory. Missing tiles are computed on worker threads
+// with the CPU kernels; until they land, the nearest cached ancestor is
+// drawn magnified in their place. Tiles evicted from memory can spill to a
+// memory-mapped file.
+const int CACHE_TILE = 256;
+const double TILE_SPAN0 = 4.0;
+const int FALLBACK_LEVELS = 8;    // how far up to look for a stand-in
+const size_t TILE_BYTES = sizeof(float) * CACHE_TILE * CACHE_TILE;
+
+struct TileKey {
+    int mode = -1, level = 0;     // mode -1 marks an empty slot
+    int64_t tx = 0, ty = 0;
+};
+
+inline bool operator==(const TileKey& a, const TileKey& b) {
+    return a.mode == b.mode && a.level == b.level && a.tx == b.tx && a.ty == b.ty;
+}
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& k) const {
+        uint64_t h = (uint64_t)k.tx * 0x9e3779b97f4a7c15ull ^ (uint64_t)k.ty * 0xc2b2ae3d27d4eb4full ^
+                     (uint64_t)(k.level * 2 + k.mode);
+        return (size_t)(h ^ h >> 29);
+    }
+};
+
+inline double tileSpan(int level) { return std::ldexp(TILE_SPAN0, -level); }
+
+inline TileKey tileParent(const TileKey& k, int up) {
+    return {k.mode, k.level - up, k.tx >> up, k.ty >> up};
+}
+
+inline int tileIterLimit(int level) { return iterLimit(tileSpan(level) / CACHE_TILE); }
+
+// The tile as an escape job. Its rows run bottom to top, the order
+// glTexSubImage3D takes them in.
+EscapeJob makeTileJob(const TileKey& k) {
+    EscapeJob job;
+    job.width = job.height = CACHE_TILE;
+    job.mode = k.mode; job.maxIter = tileIterLimit(k.level);
+    double span = tileSpan(k.level), px = span / CACHE_TILE;
+    job.wide = span < DF64_ZOOM;
+    job.iters.resize(CACHE_TILE * CACHE_TILE);
+    for(int i = 0; i < CACHE_TILE; i++) {
+        job.xd.push_back(k.tx * span + (i + 0.5) * px);
+        job.yd.push_back(k.ty * span + (i + 0.5) * px);
+        job.xs.push_back((float)job.xd.back());
+        job.ys.push_back((float)job.yd.back());
+    }
+    return job;
+}
+
+// A file of tile slots mapped into memory. Slots are reused oldest first,
+// and the index of what is where lives only as long as the process.
+class SpillStore {
+public:
+    SpillStore() = default;
+    ~SpillStore();
+    SpillStore(const SpillStore&) = delete;
+    SpillStore& operator=(const SpillStore&) = delete;
+    
+    bool open(const char* path, size_t bytes);
+    void put(const TileKey& k, const float* data);
+    bool get(const TileKey& k, float* data) const;
+
+private:
+    float* base = nullptr;
+    size_t slots = 0, next = 0;
+    std::vector<TileKey> owner;
+    std::unordered_map<TileKey, size_t, TileKeyHash> slotOf;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+bool SpillStore::open(const char* path, size_t bytes) {
+    slots = bytes / TILE_BYTES;
+    if(!slots) return false;
+    size_t size = slots * TILE_BYTES;
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+    if(file == INVALID_HANDLE_VALUE) return false;
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, nullptr);
+    if(!mapping) return false;
+    base = (float*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+#else
+    fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0 || ftruncate(fd, (off_t)size) != 0) return false;
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    base = p == MAP_FAILED ? nullptr : (float*)p;
+#endif
+    owner.assign(slots, TileKey());
+    return base != nullptr;
+}
+
+SpillStore::~SpillStore() {
+#ifdef _WIN32
+    if(base) UnmapViewOfFile(base);
+    if(mapping) CloseHandle(mapping);
+    if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+    if(base) munmap(base, slots * TILE_BYTES);
+    if(fd >= 0) close(fd);
+#endif
+}
+
+void SpillStore::put(const TileKey& k, const float* data) {
+    // a tile never changes, so a copy already spilled is still good
+    if(!base || slotOf.count(k)) return;
+    size_t s = next++ % slots;
+    if(owner[s].mode >= 0) slotOf.erase(owner[s]);
+    owner[s] = k;
+    slotOf[k] = s;
+    memcpy(base + s * CACHE_TILE * CACHE_TILE, data, TILE_BYTES);
+}
+
+bool SpillStore::get(const TileKey& k, float* data) const {
+    auto it = slotOf.find(k);
+    if(it == slotOf.end()) return false;
+    memcpy(data, base + it->second * CACHE_TILE * CACHE_TILE, TILE_BYTES);
+    return true;
+}
+
+typedef std::shared_ptr<const std::vector<float>> TileData;
+
+// Computed tiles, least recently used dropped first once over budget, plus
+// the workers that compute them.
+class TileCache {
+public:
+    TileCache(size_t budget, int threads);
+    ~TileCache();
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+    
+    // Call before the cache is used.
+    bool spillTo(const char* path, size_t bytes) { return spill.open(path, bytes); }
+    
+    // The tile's escape values, or null if it is neither in memory nor spilled.
+    TileData find(const TileKey& k);
+    
+    // Replaces the queue of tiles to compute, most wanted first.
+    void want(const std::vector<TileKey>& keys);
+    
+    // Counts computed tiles as they land.
+    unsigned generation() const { return landed; }
+
+private:
+    struct Entry {
+        TileData data;
+        std::list<TileKey>::iterator age;
+    };
+    
+    void work();
+    void insert(const TileKey& k, TileData data);
+    
+    std::mutex m;
+    std::condition_variable wake;
+    std::unordered_map<TileKey, Entry, TileKeyHash> entries;
+    std::list<TileKey> lru;          // most recently used first
+    size_t budget, used = 0;
+    SpillStore spill;
+    std::vector<TileKey> queue;
+    size_t queueNext = 0;
+    std::unordered_set<TileKey, TileKeyHash> busy;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned> landed{0};
+    bool quit = false;
+};
+
+TileCache::TileCache(size_t budget, int threads) : budget(budget) {
+    for(int i = 0; i < threads; i++)
+        workers.emplace_back(&TileCache::work, this);
+}
+
+TileCache::~TileCache() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        quit = true;
+    }
+    wake.notify_all();
+    for(auto& t : workers) t.join();
+}
+
+// Call with m held.
+void TileCache::insert(const TileKey& k, TileData data) {
+    // a worker can finish a tile that find() meanwhile brought back from the spill file
+    auto it = entries.find(k);
+    if(it != entries.end()) {
+        lru.splice(lru.begin(), lru, it->second.age);
+        return;
+    }
+    lru.push_front(k);
+    entries[k] = {data, lru.begin()};
+    used += TILE_BYTES;
+    while(used > budget && lru.size() > 1) {
+        auto victim = entries.find(lru.back());
+        spill.put(victim->first, victim->second.data->data());
+        entries.erase(victim);
+        lru.pop_back();
+        used -= TILE_BYTES;
+    }
+}
+
+TileData TileCache::find(const TileKey& k) {
+    std::lock_guard<std::mutex> lock(m);
+    auto it = entries.find(k);
+    if(it != entries.end()) {
+        lru.splice(lru.begin(), lru, it->second.age);
+        return it->second.data;
+    }
+    std::vector<float> values(CACHE_TILE * CACHE_TILE);
+    if(!spill.get(k, values.data())) return nullptr;
+    TileData data = std::make_shared<const std::vector<float>>(std::move(values));
+    insert(k, data);
+    return data;
+}
+
+void TileCache::want(const std::vector<TileKey>& keys) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        queue = keys;
+        queueNext = 0;
+    }
+    wake.notify_all();
+}
+
+void TileCache::work() {
+    for(;;) {
+        TileKey k;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            wake.wait(lock, [&]{ return quit || queueNext < queue.size(); });
+            if(quit) return;
+            k = queue[queueNext++];
+            if(entries.count(k) || busy.count(k)) continue;
+            busy.insert(k);
+        }
+        EscapeJob job = makeTileJob(k);
+        renderCpu(job, pickEscapeKernel(job.wide).fn, 1);
+        std::lock_guard<std::mutex> lock(m);
+        busy.erase(k);
+        insert(k, std::make_shared<const std::vector<float>>(std::move(job.iters)));
+        landed++;
+    }
+}
+
+// The tiles being drawn, one per layer of an array texture.
+struct TileAtlas {
+    GLuint tex = 0;
+    std::unordered_map<TileKey, int, TileKeyHash> layerOf;
+    std::vector<TileKey> owner;
+    std::vector<unsigned> lastUse;
+    unsigned frame = 1;
+};
+
+// Layers enough for the most tiles a view w by h pixels can touch: the
+// level drawn has pixels between half and all of the view's, so a tile
+// spans at least CACHE_TILE/2 of them, and each coarser level a stand-in
+// may come from halves that again.
+int atlasLayersFor(double w, double h) {
+    int layers = 0;
+    for(int up = 0; up <= FALLBACK_LEVELS; up++) {
+        double tiles = std::ldexp(2.0 / CACHE_TILE, -up);
+        layers += ((int)std::ceil(w * tiles) + 1) * ((int)std::ceil(h * tiles) + 1);
+    }
+    return layers;
+}
+
+// Grows the atlas to at least `layers`, as far as the driver allows. The
+// tiles it held are dropped; they upload again from the cache.
+void reserveAtlas(TileAtlas& a, int layers) {
+    static GLint maxLayers = 0;
+    if(!maxLayers) glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    layers = std::min(layers, (int)maxLayers);
+    if(layers <= (int)a.owner.size()) return;
+    
+    if(!a.tex) {
+        glGenTextures(1, &a.tex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, a.tex);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, a.tex);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, CACHE_TILE, CACHE_TILE, layers, 0, GL_RED, GL_FLOAT, nullptr);
+    a.layerOf.clear();
+    a.owner.assign(layers, TileKey());
+    a.lastUse.assign(layers, 0);
+}
+
+// The layer holding tile k, uploaded from the cache if need be. -1 if the
+// tile is not cached, -2 if it is but every layer is already in use this
+// frame.
+int atlasLayer(TileAtlas& a, TileCache& cache, const TileKey& k) {
+    auto it = a.layerOf.find(k);
+    if(it != a.layerOf.end()) {
+        a.lastUse[it->second] = a.frame;
+        return it->second;
+    }
+    TileData data = cache.find(k);
+    if(!data) return -1;
+    int layer = -1;
+    for(int i = 0; i < (int)a.owner.size(); i++)
+        if(a.lastUse[i] != a.frame && (layer < 0 || a.lastUse[i] < a.lastUse[layer])) layer = i;
+    if(layer < 0) return -2;
+    if(a.owner[layer].mode >= 0) a.layerOf.erase(a.owner[layer]);
+    a.owner[layer] = k;
+    a.layerOf[k] = layer;
+    a.lastUse[layer] = a.frame;
+    
+    glBindTexture(GL_TEXTURE_2D_ARRAY, a.tex);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, CACHE_TILE, CACHE_TILE, 1, GL_RED, GL_FLOAT, data->data());
+    return layer;
+}
+
+// What the tile pass draws: two triangles per tile, laid out as the quad's
+// vertices, and the atlas layer and iteration limit of the tile each pair
+// samples. maxIter is the limit of the level in view. Tiles the atlas has
+// no room for go in liveVerts, for the iteration pass to compute instead.
+struct TilePlan {
+    std::vector<float> verts, liveVerts;
+    std::vector<int> layers, limits;
+    int maxIter = 0;
+};
+
+// Plans the view at the tile level whose pixels are no bigger than the
+// view's, `pixel` across. Missing tiles are queued for the workers, nearest
+// the centre first and behind a coarse level that covers them cheaply.
+TilePlan planTiles(TileAtlas& a, TileCache& cache, double pixel, double asp) {
+    a.frame++;
+    int level = (int)std::ceil(std::log2(TILE_SPAN0 / (CACHE_TILE * pixel)));
+    double span = tileSpan(level);
+    double cx = g_centerX.hi, cy = g_centerY.hi, hw = asp * g_zoom, hh = g_zoom;
+    reserveAtlas(a, atlasLayersFor(2 * hw / pixel, 2 * hh / pixel));
+    std::vector<TileKey> keys;
+    for(int64_t ty = (int64_t)std::floor((cy - hh) / span); ty * span < cy + hh; ty++)
+        for(int64_t tx = (int64_t)std::floor((cx - hw) / span); tx * span < cx + hw; tx++)
+            keys.push_back({g_mode, level, tx, ty});
+    auto dist = [&](const TileKey& k) {
+        return std::hypot((k.tx + 0.5) * span - cx, (k.ty + 0.5) * span - cy);
+    };
+    std::sort(keys.begin(), keys.end(), [&](const TileKey& p, const TileKey& q) { return dist(p) < dist(q); });
+    
+    TilePlan plan;
+    plan.maxIter = tileIterLimit(level);
+    std::vector<TileKey> queue, missing;
+    for(const TileKey& k : keys) {
+        TileKey src = k;
+        int layer = atlasLayer(a, cache, k);
+        if(layer == -1) {
+            missing.push_back(k);
+            for(int up = 1; up <= FALLBACK_LEVELS && layer == -1; up++) {
+                src = tileParent(k, up);
+                layer = atlasLayer(a, cache, src);
+            }
+            TileKey coarse = tileParent(k, 2);
+            if(layer < 0 && std::find(queue.begin(), queue.end(), coarse) == queue.end())
+                queue.push_back(coarse);
+        }
+        if(layer == -1) continue;
+        
+        // the part of tile k in view, in quad coordinates and in src's texels
+        double x0 = std::max(k.tx * span, cx - hw), x1 = std::min((k.tx + 1) * span, cx + hw);
+        double y0 = std::max(k.ty * span, cy - hh), y1 = std::min((k.ty + 1) * span, cy + hh);
+        double srcSpan = tileSpan(src.level), sx = src.tx * srcSpan, sy = src.ty * srcSpan;
+        float corner[4][4] = {
+            {(float)((x0 - cx) / hw), (float)((y0 - cy) / hh), (float)((x0 - sx) / srcSpan), (float)((y0 - sy) / srcSpan)},
+            {(float)((x1 - cx) / hw), (float)((y0 - cy) / hh), (float)((x1 - sx) / srcSpan), (float)((y0 - sy) / srcSpan)},
+            {(float)((x1 - cx) / hw), (float)((y1 - cy) / hh), (float)((x1 - sx) / srcSpan), (float)((y1 - sy) / srcSpan)},
+            {(float)((x0 - cx) / hw), (float)((y1 - cy) / hh), (float)((x0 - sx) / srcSpan), (float)((y1 - sy) / srcSpan)},
+        };
+        if(layer < 0) {
+            for(int v : {0, 1, 2, 2, 3, 0}) {
+                float vert[5] = {corner[v][0], corner[v][1], 0, (corner[v][0] + 1) / 2, (corner[v][1] + 1) / 2};
+                plan.liveVerts.insert(plan.liveVerts.end(), vert, vert + 5);
+            }
+            continue;
+        }
+        for(int v : {0, 1, 2, 2, 3, 0}) {
+            float vert[5] = {corner[v][0], corner[v][1], 0, corner[v][2], corner[v][3]};
+            plan.verts.insert(plan.verts.end(), vert, vert + 5);
+        }
+        plan.layers.push_back(layer);
+        plan.limits.push_back(tileIterLimit(src.level));
+    }
+    queue.insert(queue.end(), missing.begin(), missing.end());
+    cache.want(queue);
+    return plan;
+}
+
+// Points the iteration pass at the current view, spread over an image of
+// w by h pixels.
+void setViewUniforms(GLuint prog, DeepView& deepView, int w, int h, int maxIter) {
+    glUniform2f(glGetUniformLocation(prog,"res"),(float)w,(float)h);
+    float hiX = (float)g_centerX.hi, hiY = (float)g_centerY.hi;
+    glUniform2f(glGetUniformLocation(prog,"centerHi"),hiX,hiY);
+    glUniform2f(glGetUniformLocation(prog,"centerLo"),(float)(g_centerX.hi - hiX),(float)(g_centerY.hi - hiY));
+    glUniform1f(glGetUniformLocation(prog,"zoom"),g_zoom);
+    
+    Tier tier = g_zoom >= DF64_ZOOM ? TIER_FLOAT
+              : g_zoom >= DEEP_ZOOM && g_df64 ? TIER_DF64 : TIER_PERTURB;
+    glUniform1i(glGetUniformLocation(prog,"tier"),tier);
+    if(tier == TIER_PERTURB) {
+        double asp = (double)w / h;
+        updateDeepView(deepView, g_zoom * std::sqrt(asp * asp + 1.0), maxIter);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, deepView.tex);
+        glUniform1i(glGetUniformLocation(prog,"orbit"),0);
+        glUniform1i(glGetUniformLocation(prog,"orbitLen"),deepView.len);
+        glUniform1i(glGetUniformLocation(prog,"skip"),deepView.skip);
+        glUniform2fv(glGetUniformLocation(prog,"series"),3,deepView.series);
+    }
+    glUniform1i(glGetUniformLocation(prog,"fractalMode"),g_mode);
+    glUniform1i(glGetUniformLocation(prog,"maxIter"),maxIter);
+}
+
+// Offline GPU render (--out without --backend cpu). The image is drawn a
+// POSTER_TILE square at a time through an offscreen iteration buffer
+// `samples` times finer and the colour pass, which averages the samples.
+// Each tile is read into one of two pixel buffers while the next one
+// renders, and every finished row of tiles is appended to the PPM, so
+// memory grows with the image width but not its height.
+const int POSTER_TILE = 512;
+const int MAX_SAMPLES = 8;
+
+bool renderPoster(const char* path, int width, int height, int samples, GLuint prog, GLuint colorProg) {
+    FILE* f = fopen(path, "wb");
+    if(!f) return false;
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    
+    int span = POSTER_TILE * samples;
+    GLuint fbo[2], tex[2];
+    glGenFramebuffers(2, fbo);
+    glGenTextures(2, tex);
+    const GLenum formats[2] = {GL_R32F, GL_RGBA8};
+    const int sizes[2] = {span, POSTER_TILE};
+    bool ok = true;
+    for(int i = 0; i < 2; i++) {
+        glBindTexture(GL_TEXTURE_2D, tex[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, formats[i], sizes[i], sizes[i], 0, GL_RED, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex[i], 0);
+        ok &= glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+    GLuint pbo[2];
+    glGenBuffers(2, pbo);
+    for(int i = 0; i < 2; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, 4 * POSTER_TILE * POSTER_TILE, nullptr, GL_STREAM_READ);
+    }
+    
+    // the tile's part of the view, as the quad's texture coordinates
+    GLuint vao, vbo;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,5*sizeof(float),(void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1,2,GL_FLOAT,GL_FALSE,5*sizeof(float),(void*)(3*sizeof(float)));
+    glEnableVertexAttribArray(1);
+    
+    glm::mat4 identity(1.0f);
+    for(GLuint p : {prog, colorProg}) {
+        glUseProgram(p);
+        glUniformMatrix4fv(glGetUniformLocation(p,"m"),1,GL_FALSE,glm::value_ptr(identity));
+        glUniformMatrix4fv(glGetUniformLocation(p,"v"),1,GL_FALSE,glm::value_ptr(identity));
+        glUniformMatrix4fv(glGetUniformLocation(p,"p"),1,GL_FALSE,glm::value_ptr(identity));
+    }
+    int maxIter = iterLimit(2.0 * g_zoom / ((double)height * samples));
+    DeepView deepView;
+    glUseProgram(prog);
+    setViewUniforms(prog, deepView, width, height, maxIter);
+    glUseProgram(colorProg);
+    glUniform1i(glGetUniformLocation(colorProg,"iters"),0);
+    glUniform1i(glGetUniformLocation(colorProg,"maxIter"),maxIter);
+    glUniform1f(glGetUniformLocation(colorProg,"phase"),0.0f);
+    glUniform1i(glGetUniformLocation(colorProg,"samples"),samples);
+    
+    // a tile waiting in a pixel buffer
+    struct Pending { int x0, y0, w, h, pbo; };
+    std::vector<Pending> pending;
+    std::vector<unsigned char> band((size_t)3 * width * POSTER_TILE);
+    auto drain = [&](const Pending& t) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[t.pbo]);
+        const unsigned char* px = (const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if(!px) { ok = false; return; }
+        // pixel buffer rows run bottom up, the PPM's top down
+        for(int y = 0; y < t.h; y++) {
+            const unsigned char* src = px + (size_t)4 * (t.h - 1 - y) * t.w;
+            unsigned char* dst = &band[(size_t)3 * ((size_t)y * width + t.x0)];
+            for(int x = 0; x < t.w; x++)
+                for(int c = 0; c < 3; c++) dst[3 * x + c] = src[4 * x + c];
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        if(t.x0 + t.w == width)
+            ok &= fwrite(band.data(), 1, (size_t)3 * width * t.h, f) == (size_t)3 * width * t.h;
+    };
+    
+    int next = 0;
+    for(int y0 = 0; y0 < height && ok; y0 += POSTER_TILE) {
+        for(int x0 = 0; x0 < width && ok; x0 += POSTER_TILE) {
+            int w = std::min(POSTER_TILE, width - x0), h = std::min(POSTER_TILE, height - y0);
+            float u0 = (float)x0 / width, u1 = (float)(x0 + w) / width;
+            float v0 = 1.0f - (float)(y0 + h) / height, v1 = 1.0f - (float)y0 / height;
+            float verts[] = {
+                -1,-1,0, u0,v0,   1,-1,0, u1,v0,   1, 1,0, u1,v1,
+                -1,-1,0, u0,v0,   1, 1,0, u1,v1,  -1, 1,0, u0,v1,
+            };
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STREAM_DRAW);
+            
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo[0]);
+            glViewport(0, 0, w * samples, h * samples);
+            glUseProgram(prog);
+            if(deepView.tex) {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, deepView.tex);
+            }
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo[1]);
+            glViewport(0, 0, w, h);
+            glUseProgram(colorProg);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, tex[0]);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[next]);
+            glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            pending.push_back(Pending{x0, y0, w, h, next});
+            next = 1 - next;
+            if(pending.size() == 2) {
+                drain(pending[0]);
+                pending.erase(pending.begin());
+            }
+        }
+    }
+    for(const Pending& t : pending)
+        if(ok) drain(t);
+    
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(2, pbo);
+    glDeleteFramebuffers(2, fbo);
+    glDeleteTextures(2, tex);
+    glDeleteTextures(1, &deepView.tex);
+    return (fclose(f) == 0) && ok;
+}
+
+// Zoom path (--path): one keyframe per line, "T X,Y Z mandel|julia" for
+// the view at T seconds. '#' starts a comment.
+struct Keyframe {
+    double t;
+    dd x, y;
+    double zoom;
+    int mode;
+};
+
+bool loadPath(const char* path, std::vector<Keyframe>& keys) {
+    FILE* f = fopen(path, "r");
+    if(!f) return false;
+    char line[512];
+    bool ok = true;
+    for(int n = 1; ok && fgets(line, sizeof(line), f); n++) {
+        if(char* hash = strchr(line, '#')) *hash = 0;
+        char centre[256], mode[16];
+        Keyframe k;
+        int fields = sscanf(line, "%lf %255s %lf %15s", &k.t, centre, &k.zoom, mode);
+        if(fields == EOF) continue;  // blank or only a comment
+        const char* end = fields == 4 ? parseDd(centre, k.x) : nullptr;
+        ok = end && *end == ',' && (end = parseDd(end + 1, k.y)) && !*end &&
+             k.zoom >= MIN_ZOOM && (strcmp(mode, "mandel") == 0 || strcmp(mode, "julia") == 0) &&
+             (keys.empty() || k.t > keys.back().t);
+        if(ok) {
+            k.mode = strcmp(mode, "julia") == 0;
+            keys.push_back(k);
+        } else std::cerr<<path<<":"<<n<<": expected \"T X,Y Z mandel|julia\" after the previous time"<<std::endl;
+    }
+    fclose(f);
+    return ok && !keys.empty();
+}
+
+// Sets the view to the path at time t. Zoom changes exponentially between
+// keyframes, a constant rate on screen, and the centre moves in step with
+// it so it settles on the target as the view closes in instead of racing
+// across it at depth. A segment keeps its first keyframe's mode.
+void setPathView(const std::vector<Keyframe>& keys, double t) {
+    size_t i = 0;
+    while(i + 1 < keys.size() && keys[i + 1].t <= t) i++;
+    const Keyframe& a = keys[i];
+    g_zoom = a.zoom; g_centerX = a.x; g_centerY = a.y; g_mode = a.mode;
+    if(i + 1 == keys.size() || t <= a.t) return;
+    const Keyframe& b = keys[i + 1];
+    double s = (t - a.t) / (b.t - a.t);
+    g_zoom = a.zoom * std::pow(b.zoom / a.zoom, s);
+    double w = a.zoom == b.zoom ? s : (a.zoom - g_zoom) / (a.zoom - b.zoom);
+    g_centerX = a.x + (b.x - a.x) * w;
+    g_centerY = a.y + (b.y - a.y) * w;
+}
+
+// True if pattern has exactly one conversion, an integer like %05d for the
+// frame number.
+bool isFramePattern(const char* pattern) {
+    const char* pc = strchr(pattern, '%');
+    if(!pc || strchr(pc + 1, '%')) return false;
+    pc++;
+    while(*pc >= '0' && *pc <= '9') pc++;
+    return *pc == 'd';
+}
+
+// Renders this shard's frames of the path with render(file): frames
+// shard, shard + shards, ..., named by the printf pattern. Interleaving
+// gives every shard its share of the slow deep frames. A frame's time is
+// its number over fps and nothing else, so any process, on any machine,
+// renders it the same.
+bool renderPath(const std::vector<Keyframe>& keys, double fps, int shard, int shards,
+                const char* pattern, const std::function<bool(const char*)>& render) {
+    int frames = (int)std::floor((keys.back().t - keys.front().t) * fps + 1e-9) + 1;
+    for(int f = shard; f < frames; f += shards) {
+        char file[1024];
+        snprintf(file, sizeof(file), pattern, f);
+        setPathView(keys, keys.front().t + f / fps);
+        std::cout<<"Frame "<<f + 1<<"/"<<frames<<": "<<file<<std::endl;
+        if(!render(file)) return false;
+    }
+    return true;
+}
+
+const char* usage =
+    "Usage: fractal [options]\n"
+    "  --center X,Y          view centre (default -0.5,0)\n"
+    "  --zoom Z              view half-height (default 2)\n"
+    "  --mode mandel|julia   fractal to draw (default mandel)\n"
+    "  --backend gpu|cpu     renderer; cpu only renders images for --out (default gpu)\n"
+    "  --size WxH            image size for --out (default 1600x900)\n"
+    "  --supersample N       N x N samples per pixel for a gpu --out (default 1, up to 8)\n"
+    "  --max-iter N          iteration limit (default: grows with zoom depth)\n"
+    "  --subdivide           skip the inside of rectangles bordered by the set (--backend cpu\n"
+    "                        and the tile cache)\n"
+    "  --threads N           threads for --backend cpu and the tile cache (default: all cores)\n"
+    "  --out FILE            render one image to this PPM instead of opening a window\n"
+    "  --path FILE           render the keyframed zoom path in FILE (lines of \"T X,Y Z\n"
+    "                        mandel|julia\") to numbered PPMs; --out is then a pattern such\n"
+    "                        as frame%05d.ppm\n"
+    "  --fps N               frames per second of --path (default 30)\n"
+    "  --shard I/N           render only frames I, I+N, I+2N, ... of --path (default 0/1)\n"
+    "  --cache MB            draw from a tile cache of up to MB in memory (default off, 256 once T\n"
+    "                        turns it on)\n"
+    "  --cache-file FILE     spill tiles evicted from the cache to FILE, up to 4x its size\n";
+
+int main(int argc, char** argv){
+    bool useCpu = false;
+    int imageW = 1600, imageH = 900, samples = 1;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* outPath = nullptr;
+    const char* pathFile = nullptr;
+    double fps = 30;
+    int shard = 0, shards = 1;
+    size_t cacheMb = 0;
+    const char* cacheFile = nullptr;
+    for(int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = true;
+        if(strcmp(arg, "--center") == 0 && val) {
+            const char* end = parseDd(val, g_centerX);
+            ok = end && *end == ',' && (end = parseDd(end + 1, g_centerY)) && !*end;
+            i++;
+        } else if(strcmp(arg, "--zoom") == 0 && val) {
+            g_zoom = atof(val);
+            ok = g_zoom >= MIN_ZOOM;
+            i++;
+        } else if(strcmp(arg, "--mode") == 0 && val) {
+            ok = strcmp(val, "mandel") == 0 || strcmp(val, "julia") == 0;
+            g_mode = strcmp(val, "julia") == 0;
+            i++;
+        } else if(strcmp(arg, "--backend") == 0 && val) {
+            ok = strcmp(val, "gpu") == 0 || strcmp(val, "cpu") == 0;
+            useCpu = strcmp(val, "cpu") == 0;
+            i++;
+        } else if(strcmp(arg, "--size") == 0 && val) {
+            ok = sscanf(val, "%dx%d", &imageW, &imageH) == 2 && imageW > 0 && imageH > 0;
+            i++;
+        } else if(strcmp(arg, "--supersample") == 0 && val) {
+            samples = atoi(val);
+            ok = samples >= 1 && samples <= MAX_SAMPLES;
+            i++;
+        } else if(strcmp(arg, "--max-iter") == 0 && val) {
+            g_maxIter = atoi(val);
+            ok = g_maxIter >= 1;
+            i++;
+        } else if(strcmp(arg, "--subdivide") == 0) {
+            g_subdivide = true;
+        } else if(strcmp(arg, "--threads") == 0 && val) {
+            threads = atoi(val);
+            ok = threads >= 1;
+            i++;
+        } else if(strcmp(arg, "--out") == 0 && val) {
+            outPath = val;
+            i++;
+        } else if(strcmp(arg, "--path") == 0 && val) {
+            pathFile = val;
+            i++;
+        } else if(strcmp(arg, "--fps") == 0 && val) {
+            fps = atof(val);
+            ok = fps > 0;
+            i++;
+        } else if(strcmp(arg, "--shard") == 0 && val) {
+            ok = sscanf(val, "%d/%d", &shard, &shards) == 2 && shard >= 0 && shard < shards;
+            i++;
+        } else if(strcmp(arg, "--cache") == 0 && val) {
+            cacheMb = (size_t)atol(val);
+            ok = atol(val) >= 1;
+            i++;
+        } else if(strcmp(arg, "--cache-file") == 0 && val) {
+            cacheFile = val;
+            i++;
+        } else {
+            ok = false;
+        }
+        if(!ok) {
+            std::cerr<<"Bad option: "<<arg<<"\n"<<usage;
+            return -1;
+        }
+    }
+    
+    std::vector<Keyframe> keys;
+    if(pathFile) {
+        if(!outPath || !isFramePattern(outPath)) {
+            std::cerr<<"--path needs --out with a frame number, like frame%05d.ppm\n"<<usage;
+            return -1;
+        }
+        if(!loadPath(pathFile, keys)) {
+            std::cerr<<"Could not read a zoom path from "<<pathFile<<std::endl;
+            return -1;
+        }
+    }
+    
+    if(useCpu) {
+        if(!outPath) {
+            std::cerr<<"--backend cpu needs --out\n"<<usage;
+            return -1;
+        }
+        // zoom is monotonic between keyframes, so the keyframes bound it
+        double deepest = g_zoom;
+        for(const Keyframe& k : keys) deepest = std::min(deepest, k.zoom);
+        if(deepest < DEEP_ZOOM) {
+            std::cerr<<"--backend cpu renders down to zoom "<<DEEP_ZOOM<<"\n"<<usage;
+            return -1;
+        }
+        auto render = [&](const char* file) {
+            EscapeJob job = makeEscapeJob(imageW, imageH);
+            EscapeKernelChoice kernel = pickEscapeKernel(job.wide);
+            std::cout<<"Fractal kernel: "<<kernel.name<<", "<<imageW<<"x"<<imageH
+                     <<", "<<threads<<" threads"<<std::endl;
+            size_t iterated = renderCpu(job, kernel.fn, threads);
+            if(g_subdivide)
+                std::cout<<"Subdivision iterated "<<100.0 * iterated / job.iters.size()<<"% of pixels"<<std::endl;
+            if(!writePpm(file, job)) {
+                std::cerr<<"Could not write "<<file<<std::endl;
+                return false;
+            }
+            return true;
+        };
+        bool ok = keys.empty() ? render(outPath) : renderPath(keys, fps, shard, shards, outPath, render);
+        return ok ? 0 : -1;
+    }
+    
     if(!glfwInit()){
         std::cerr<<"GLFW init fail"<<std::endl;
         return -1;
@@ -156,6 +1865,7 @@ int main(){
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR,3);
     glfwWindowHint(GLFW_OPENGL_PROFILE,GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE,outPath ? GLFW_FALSE : GLFW_TRUE);
     
     GLFWwindow* win=glfwCreateWindow(1600,900,"Fractal Explorer",nullptr,nullptr);
     if(!win){
@@ -176,6 +1886,11 @@ int main(){
     }
 #endif
     
+    GLint extCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extCount);
+    for(GLint i = 0; i < extCount; i++)
+        if(strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_gpu_shader5") == 0) g_df64 = true;
+    
     glViewport(0,0,1600,900);
     
     float verts[]={
@@ -200,21 +1915,71 @@ int main(){
     glVertexAttribPointer(1,2,GL_FLOAT,GL_FALSE,5*sizeof(float),(void*)(3*sizeof(float)));
     glEnableVertexAttribArray(1);
     
-    GLuint prog=mkProg();
+    GLuint prog=mkProg(vtx,iterFrag);
+    GLuint colorProg=mkProg(vtx,colorFrag);
+    GLuint tileProg=mkProg(vtx,tileFrag);
+    
+    GLuint tileVao,tileVbo;
+    glGenVertexArrays(1,&tileVao);
+    glGenBuffers(1,&tileVbo);
+    glBindVertexArray(tileVao);
+    glBindBuffer(GL_ARRAY_BUFFER,tileVbo);
+    glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,5*sizeof(float),(void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1,2,GL_FLOAT,GL_FALSE,5*sizeof(float),(void*)(3*sizeof(float)));
+    glEnableVertexAttribArray(1);
+    
     glm::mat4 mdl=glm::mat4(1.0f);
     glm::mat4 view=glm::translate(glm::mat4(1.0f),glm::vec3(0,0,-3));
+    DeepView deepView;
+    IterBuffer iterBuf;
+    bool cyclePalette = false, pWasDown = false;
+    
+    std::unique_ptr<TileCache> cache;
+    TileAtlas atlas;
+    bool useCache = cacheMb > 0 || cacheFile, tWasDown = false;
+    unsigned composedGen = 0;
+    int tileMaxIter = 0;
+    float phase = 0, lastTime = 0;
+    
+    int status = 0;
+    if(outPath) {
+        std::cout<<"Fractal poster: "<<imageW<<"x"<<imageH<<", "<<samples<<"x"<<samples
+                 <<" samples per pixel"<<std::endl;
+        auto render = [&](const char* file) {
+            if(renderPoster(file, imageW, imageH, samples, prog, colorProg)) return true;
+            std::cerr<<"Could not render "<<file<<std::endl;
+            return false;
+        };
+        if(!(keys.empty() ? render(outPath) : renderPath(keys, fps, shard, shards, outPath, render)))
+            status = -1;
+        glfwSetWindowShouldClose(win, true);
+    }
     
     while(!glfwWindowShouldClose(win)){
         if(glfwGetKey(win,GLFW_KEY_ESCAPE)==GLFW_PRESS)
             glfwSetWindowShouldClose(win,true);
         
-        float panSpeed = g_zoom * 0.05f;
-        if(glfwGetKey(win,GLFW_KEY_W)==GLFW_PRESS) g_centerY -= panSpeed;
-        if(glfwGetKey(win,GLFW_KEY_S)==GLFW_PRESS) g_centerY += panSpeed;
-        if(glfwGetKey(win,GLFW_KEY_A)==GLFW_PRESS) g_centerX -= panSpeed;
-        if(glfwGetKey(win,GLFW_KEY_D)==GLFW_PRESS) g_centerX += panSpeed;
-        if(glfwGetKey(win,GLFW_KEY_Q)==GLFW_PRESS) g_zoom *= 0.98f;
-        if(glfwGetKey(win,GLFW_KEY_E)==GLFW_PRESS) g_zoom *= 1.02f;
+        int w,h;
+        glfwGetFramebufferSize(win,&w,&h);
+        float asp=(float)w/(float)h;
+        glm::mat4 proj=glm::perspective(glm::radians(45.0f),asp,0.1f,100.0f);
+        
+        // pixels the quad covers; the view spans 2*asp*zoom by 2*zoom across it
+        glm::vec4 corner=proj*view*mdl*glm::vec4(1,1,0,1);
+        double quadW = corner.x / corner.w * w, quadH = corner.y / corner.w * h;
+        Tile quad = {(int)std::floor((w - quadW) / 2), (int)std::floor((h - quadH) / 2),
+                     (int)std::ceil((w + quadW) / 2), (int)std::ceil((h + quadH) / 2)};
+        
+        // pans move by whole pixels so the iteration buffer can be shifted
+        double panX = std::max(1.0, std::round(0.05 * quadW / (2.0 * asp))) * 2.0 * asp * g_zoom / quadW;
+        double panY = std::max(1.0, std::round(0.05 * quadH / 2.0)) * 2.0 * g_zoom / quadH;
+        if(glfwGetKey(win,GLFW_KEY_W)==GLFW_PRESS) g_centerY -= panY;
+        if(glfwGetKey(win,GLFW_KEY_S)==GLFW_PRESS) g_centerY += panY;
+        if(glfwGetKey(win,GLFW_KEY_A)==GLFW_PRESS) g_centerX -= panX;
+        if(glfwGetKey(win,GLFW_KEY_D)==GLFW_PRESS) g_centerX += panX;
+        if(glfwGetKey(win,GLFW_KEY_Q)==GLFW_PRESS) g_zoom = fmax(MIN_ZOOM, g_zoom * 0.98);
+        if(glfwGetKey(win,GLFW_KEY_E)==GLFW_PRESS) g_zoom *= 1.02;
         if(glfwGetKey(win,GLFW_KEY_SPACE)==GLFW_PRESS) {
             static bool pressed = false;
             if(!pressed) {
@@ -225,33 +1990,103 @@ int main(){
             static bool pressed = false;
             pressed = false;
         }
+        bool pDown = glfwGetKey(win,GLFW_KEY_P)==GLFW_PRESS;
+        if(pDown && !pWasDown) cyclePalette = !cyclePalette;
+        pWasDown = pDown;
+        bool tDown = glfwGetKey(win,GLFW_KEY_T)==GLFW_PRESS;
+        if(tDown && !tWasDown) useCache = !useCache;
+        tWasDown = tDown;
+        if(useCache && !cache) {
+            size_t budget = (cacheMb ? cacheMb : 256) << 20;
+            cache.reset(new TileCache(budget, threads));
+            if(cacheFile && !cache->spillTo(cacheFile, 4 * budget))
+                std::cerr<<"Could not map "<<cacheFile<<", tiles will not spill"<<std::endl;
+        }
         if(glfwGetKey(win,GLFW_KEY_R)==GLFW_PRESS) {
-            g_zoom = 2.0f;
-            g_centerX = -0.5f;
-            g_centerY = 0.0f;
+            g_zoom = 2.0;
+            g_centerX = -0.5;
+            g_centerY = 0.0;
         }
         
-        int w,h;
-        glfwGetFramebufferSize(win,&w,&h);
-        float asp=(float)w/(float)h;
-        glm::mat4 proj=glm::perspective(glm::radians(45.0f),asp,0.1f,100.0f);
-        
-        glClearColor(0,0,0,1);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glUseProgram(prog);
+        double pixelX = 2.0 * asp * g_zoom / quadW, pixelY = 2.0 * g_zoom / quadH;
+        int maxIter = iterLimit(pixelY);
         
         float tm=glfwGetTime();
-        
-        glUniform1f(glGetUniformLocation(prog,"t"),tm);
-        glUniform2f(glGetUniformLocation(prog,"res"),(float)w,(float)h);
-        glUniform2f(glGetUniformLocation(prog,"center"),g_centerX,g_centerY);
-        glUniform1f(glGetUniformLocation(prog,"zoom"),g_zoom);
-        glUniform1i(glGetUniformLocation(prog,"fractalMode"),g_mode);
-        glUniformMatrix4fv(glGetUniformLocation(prog,"m"),1,GL_FALSE,glm::value_ptr(mdl));
-        glUniformMatrix4fv(glGetUniformLocation(prog,"v"),1,GL_FALSE,glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(prog,"p"),1,GL_FALSE,glm::value_ptr(proj));
+        if(cyclePalette) phase = std::fmod(phase + (tm - lastTime) * 0.05f, 1.0f);
+        lastTime = tm;
         
         glBindVertexArray(vao);
+        // the cache covers the float and double range; deeper views stay live
+        bool tiled = useCache && g_zoom >= DEEP_ZOOM;
+        if(tiled) {
+            unsigned gen = cache->generation();
+            if(updateTiledBuffer(iterBuf, w, h) || gen != composedGen) {
+                composedGen = gen;
+                TilePlan plan = planTiles(atlas, *cache, pixelY, asp);
+                tileMaxIter = plan.maxIter;
+                glBindFramebuffer(GL_FRAMEBUFFER, iterBuf.fbo[iterBuf.cur]);
+                const float unknown[4] = {1e30f, 0, 0, 0};  // shows black until its tile lands
+                glClearBufferfv(GL_COLOR, 0, unknown);
+                glUseProgram(tileProg);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, atlas.tex);
+                glUniform1i(glGetUniformLocation(tileProg,"tiles"),0);
+                glUniformMatrix4fv(glGetUniformLocation(tileProg,"m"),1,GL_FALSE,glm::value_ptr(mdl));
+                glUniformMatrix4fv(glGetUniformLocation(tileProg,"v"),1,GL_FALSE,glm::value_ptr(view));
+                glUniformMatrix4fv(glGetUniformLocation(tileProg,"p"),1,GL_FALSE,glm::value_ptr(proj));
+                glBindVertexArray(tileVao);
+                glBindBuffer(GL_ARRAY_BUFFER,tileVbo);
+                glBufferData(GL_ARRAY_BUFFER,plan.verts.size()*sizeof(float),plan.verts.data(),GL_STREAM_DRAW);
+                for(size_t i = 0; i < plan.layers.size(); i++) {
+                    glUniform1i(glGetUniformLocation(tileProg,"layer"),plan.layers[i]);
+                    glUniform1f(glGetUniformLocation(tileProg,"limit"),(float)plan.limits[i]);
+                    glDrawArrays(GL_TRIANGLES,(GLint)(6 * i),6);
+                }
+                if(!plan.liveVerts.empty()) {
+                    glUseProgram(prog);
+                    setViewUniforms(prog, deepView, w, h, plan.maxIter);
+                    glUniformMatrix4fv(glGetUniformLocation(prog,"m"),1,GL_FALSE,glm::value_ptr(mdl));
+                    glUniformMatrix4fv(glGetUniformLocation(prog,"v"),1,GL_FALSE,glm::value_ptr(view));
+                    glUniformMatrix4fv(glGetUniformLocation(prog,"p"),1,GL_FALSE,glm::value_ptr(proj));
+                    glBufferData(GL_ARRAY_BUFFER,plan.liveVerts.size()*sizeof(float),plan.liveVerts.data(),GL_STREAM_DRAW);
+                    glDrawArrays(GL_TRIANGLES,0,(GLsizei)(plan.liveVerts.size() / 5));
+                }
+                glBindVertexArray(vao);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+        } else {
+            std::vector<Tile> dirty = updateIterBuffer(iterBuf, w, h, pixelX, pixelY, quad);
+            if(!dirty.empty()) {
+                glBindFramebuffer(GL_FRAMEBUFFER, iterBuf.fbo[iterBuf.cur]);
+                glUseProgram(prog);
+                
+                setViewUniforms(prog, deepView, w, h, maxIter);
+                glUniformMatrix4fv(glGetUniformLocation(prog,"m"),1,GL_FALSE,glm::value_ptr(mdl));
+                glUniformMatrix4fv(glGetUniformLocation(prog,"v"),1,GL_FALSE,glm::value_ptr(view));
+                glUniformMatrix4fv(glGetUniformLocation(prog,"p"),1,GL_FALSE,glm::value_ptr(proj));
+                glEnable(GL_SCISSOR_TEST);
+                for(const Tile& r : dirty) {
+                    glScissor(r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0);
+                    glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+                }
+                glDisable(GL_SCISSOR_TEST);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+        }
+        
+        // same quad again, so only the pixels the iteration pass wrote are read
+        glClearColor(0,0,0,1);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glUseProgram(colorProg);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, iterBuf.tex[iterBuf.cur]);
+        glUniform1i(glGetUniformLocation(colorProg,"iters"),0);
+        glUniform1i(glGetUniformLocation(colorProg,"maxIter"),tiled ? tileMaxIter : maxIter);
+        glUniform1f(glGetUniformLocation(colorProg,"phase"),phase);
+        glUniform1i(glGetUniformLocation(colorProg,"samples"),1);
+        glUniformMatrix4fv(glGetUniformLocation(colorProg,"m"),1,GL_FALSE,glm::value_ptr(mdl));
+        glUniformMatrix4fv(glGetUniformLocation(colorProg,"v"),1,GL_FALSE,glm::value_ptr(view));
+        glUniformMatrix4fv(glGetUniformLocation(colorProg,"p"),1,GL_FALSE,glm::value_ptr(proj));
         glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
         glfwSwapBuffers(win);
         glfwPollEvents();
@@ -261,6 +2096,14 @@ int main(){
     glDeleteBuffers(1,&vbo);
     glDeleteBuffers(1,&ebo);
     glDeleteProgram(prog);
+    glDeleteProgram(colorProg);
+    glDeleteProgram(tileProg);
+    glDeleteVertexArrays(1,&tileVao);
+    glDeleteBuffers(1,&tileVbo);
+    glDeleteTextures(1,&atlas.tex);
+    glDeleteTextures(1,&deepView.tex);
+    glDeleteTextures(2,iterBuf.tex);
+    glDeleteFramebuffers(2,iterBuf.fbo);
     glfwTerminate();
-    return 0;
+    return status;
 }
\ No newline at end of file
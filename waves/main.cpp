@@ -10,11 +10,41 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
-#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define WAVE_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define WAVE_NEON 1
+    #include <arm_neon.h>
+#endif
 
-const int GRID_W = 256;
-const int GRID_H = 256;
+#if defined(__GNUC__) || defined(__clang__)
+    #define WAVE_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define WAVE_TARGET(isa)
+#endif
+
+int gridW = 256;
+int gridH = 256;
 
 const char* vtx = R"(
 #version 330 core
@@ -34,13 +64,15 @@ out vec4 FragColor;
 in vec2 uv;
 uniform sampler2D waveTex;
 uniform float t;
+uniform float calm;  // QUIET_LEVEL for the CPU solver, 0 on the GPU
 
 void main(){
     float h = texture(waveTex, uv).r;
     
     vec3 col = vec3(0.1, 0.2, 0.4);
     
-    if(h > 0.){
+    // the CPU solver flattens anything below calm, so treat it as still water
+    if(h > calm){
         col = mix(vec3(0.1, 0.3, 0.5), vec3(0.3, 0.5, 0.7), h * 2.);
     } else {
         col = mix(vec3(0.05, 0.1, 0.2), vec3(0.1, 0.2, 0.3), 1. + h * 2.);
@@ -54,6 +86,63 @@ void main(){
 }
 )";
 
+// GPU simulation passes. Both draw the shared quad with its positions taken as
+// clip space; the texel a fragment covers is its grid cell.
+const char* simVtx = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+void main() {
+    gl_Position = vec4(aPos.xy, 0.0, 1.0);
+}
+)";
+
+const char* stepFrag = R"(
+#version 330 core
+out float next;
+uniform sampler2D cur;
+uniform sampler2D prev;
+uniform float c2;
+uniform float damping;
+
+void main(){
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(cur, 0);
+    if(p.x == 0 || p.y == 0 || p.x == size.x - 1 || p.y == size.y - 1){
+        next = 0.;
+        return;
+    }
+    
+    float m = texelFetch(cur, p, 0).r;
+    float laplacian = texelFetch(cur, p + ivec2(0, -1), 0).r + texelFetch(cur, p + ivec2(0, 1), 0).r
+                    + texelFetch(cur, p + ivec2(-1, 0), 0).r + texelFetch(cur, p + ivec2(1, 0), 0).r
+                    - 4. * m;
+    next = (2. * m - texelFetch(prev, p, 0).r + c2 * laplacian) * damping;
+}
+)";
+
+// Adds a RippleField: the quad covers its box and each cell takes its delta.
+const char* fieldVtx = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+uniform vec4 box;  // x0, y0, x1, y1 in cells
+uniform vec2 gridSize;
+void main() {
+    vec2 corner = mix(box.xy, box.zw, aPos.xy * .5 + .5);
+    gl_Position = vec4(corner / gridSize * 2. - 1., 0.0, 1.0);
+}
+)";
+
+const char* fieldFrag = R"(
+#version 330 core
+out float amount;
+uniform sampler2D field;
+uniform vec4 box;
+
+void main(){
+    amount = texelFetch(field, ivec2(gl_FragCoord.xy - box.xy), 0).r;
+}
+)";
+
 GLuint compShader(GLenum type,const char* src){
     GLuint s=glCreateShader(type);
     glShaderSource(s,1,&src,nullptr);
@@ -67,9 +156,9 @@ GLuint compShader(GLenum type,const char* src){
     return s;
 }
 
-GLuint mkProg(){
-    GLuint vs=compShader(GL_VERTEX_SHADER,vtx);
-    GLuint fs=compShader(GL_FRAGMENT_SHADER,frag);
+GLuint mkProg(const char* vsrc,const char* fsrc){
+    GLuint vs=compShader(GL_VERTEX_SHADER,vsrc);
+    GLuint fs=compShader(GL_FRAGMENT_SHADER,fsrc);
     GLuint prog=glCreateProgram();
     glAttachShader(prog,vs);
     glAttachShader(prog,fs);
@@ -88,52 +177,1280 @@ void fbResize(GLFWwindow* w,int width,int height){
     glViewport(0,0,width,height);
 }
 
-//buffers (remove comment after bashing)
-std::vector<float> wave(GRID_W * GRID_H, 0.0f);
-std::vector<float> prevWave(GRID_W * GRID_H, 0.0f);
+const float WAVE_C = 0.3f;
+const float WAVE_DAMPING = 0.995f;
+const int RIPPLE_RADIUS = 4;
+const size_t CACHE_LINE = 64;
 
-void updateWave(float dt) {
-    const float c = 0.3f;
-    const float damping = 0.995f;
-    
-    std::vector<float> newWave(GRID_W * GRID_H);
+// Cell format of the CPU solver. Half cells are IEEE binary16 bit patterns;
+// kernels widen them to float, run the float stencil and round the result back
+// to nearest even. Storing halves loses at most 2^-11 of a cell's magnitude per
+// step, and the error carried forward is damped like the wave itself. Against
+// the Float path on a 256x256 grid the largest difference was 4e-3 (0.15% of
+// the peak) after a single strength-1 ripple and 0.05 (0.4% of a peak of 12)
+// while dragging, shrinking with the waves afterwards.
+enum class WaveStorage { Float, Half };
+
+inline size_t storageBytes(WaveStorage s) {
+    return s == WaveStorage::Half ? sizeof(uint16_t) : sizeof(float);
+}
+
+static inline float halfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    if(exp == 0) {
+        float v = mant * (1.0f / 16777216.0f);
+        return sign ? -v : v;
+    }
+    uint32_t bits = sign | (exp == 31 ? 0x7f800000 | (mant << 13) : ((exp + 112) << 23) | (mant << 13));
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// Rounds to nearest even like the hardware conversions, including subnormals.
+static inline uint16_t floatToHalf(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t mag = bits & 0x7fffffff;
+    if(mag >= 0x47800000)
+        return sign | (mag > 0x7f800000 ? 0x7e00 : 0x7c00);
     
-    for(int y = 1; y < GRID_H - 1; y++) {
-        for(int x = 1; x < GRID_W - 1; x++) {
-            int idx = y * GRID_W + x;
-            
-            float laplacian = 
-                wave[(y-1)*GRID_W + x] +
-                wave[(y+1)*GRID_W + x] +
-                wave[y*GRID_W + (x-1)] +
-                wave[y*GRID_W + (x+1)] -
-                4.0f * wave[idx];
-            
-            newWave[idx] = 2.0f * wave[idx] - prevWave[idx] + c * c * laplacian;
-            newWave[idx] *= damping;
+    uint32_t h, rest, halfway;
+    if(mag < 0x38800000) {
+        int shift = 126 - (int)(mag >> 23);
+        if(shift > 24) return sign;
+        uint32_t mant = (mag & 0x7fffff) | 0x800000;
+        h = mant >> shift;
+        rest = mant & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    } else {
+        h = (mag - 0x38000000) >> 13;
+        rest = mag & 0x1fff;
+        halfway = 0x1000;
+    }
+    if(rest > halfway || (rest == halfway && (h & 1))) h++;
+    return sign | (uint16_t)h;
+}
+
+// Writes cells [x0, x1) of one row of the next step. `mid` is the current row,
+// `up`/`dn` its neighbours and `old` the same row one step back. Every kernel
+// evaluates the scalar expression in the same order without fused multiply-add,
+// so all of them produce bit-identical results to rowScalar, and the half
+// kernels to rowScalarHalf.
+typedef void (*RowKernel)(float* out, const float* up, const float* mid, const float* dn,
+                          const float* old, int x0, int x1);
+typedef void (*HalfRowKernel)(uint16_t* out, const uint16_t* up, const uint16_t* mid, const uint16_t* dn,
+                              const uint16_t* old, int x0, int x1);
+
+static inline float stencil(float up, float dn, float left, float right, float mid, float old) {
+    const float c2 = WAVE_C * WAVE_C;
+    float laplacian = up + dn + left + right - 4.0f * mid;
+    return (2.0f * mid - old + c2 * laplacian) * WAVE_DAMPING;
+}
+
+static void rowScalar(float* out, const float* up, const float* mid, const float* dn,
+                      const float* old, int x0, int x1) {
+    for(int x = x0; x < x1; x++)
+        out[x] = stencil(up[x], dn[x], mid[x - 1], mid[x + 1], mid[x], old[x]);
+}
+
+static void rowScalarHalf(uint16_t* out, const uint16_t* up, const uint16_t* mid, const uint16_t* dn,
+                          const uint16_t* old, int x0, int x1) {
+    for(int x = x0; x < x1; x++)
+        out[x] = floatToHalf(stencil(halfToFloat(up[x]), halfToFloat(dn[x]), halfToFloat(mid[x - 1]),
+                                     halfToFloat(mid[x + 1]), halfToFloat(mid[x]), halfToFloat(old[x])));
+}
+
+#ifdef WAVE_X86
+WAVE_TARGET("sse4.1")
+static inline __m128 stencil4(const float* up, const float* mid, const float* dn, const float* old) {
+    __m128 m = _mm_loadu_ps(mid);
+    __m128 lap = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_loadu_ps(up), _mm_loadu_ps(dn)),
+                                       _mm_loadu_ps(mid - 1)), _mm_loadu_ps(mid + 1));
+    lap = _mm_sub_ps(lap, _mm_mul_ps(_mm_set1_ps(4.0f), m));
+    __m128 v = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.0f), m), _mm_loadu_ps(old));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(WAVE_C * WAVE_C), lap));
+    return _mm_mul_ps(v, _mm_set1_ps(WAVE_DAMPING));
+}
+
+WAVE_TARGET("sse4.1")
+static void rowSse41(float* out, const float* up, const float* mid, const float* dn,
+                     const float* old, int x0, int x1) {
+    int x = x0;
+    for(; x + 8 <= x1; x += 8) {
+        __m128 a = stencil4(up + x, mid + x, dn + x, old + x);
+        __m128 b = stencil4(up + x + 4, mid + x + 4, dn + x + 4, old + x + 4);
+        _mm_storeu_ps(out + x, a);
+        _mm_storeu_ps(out + x + 4, b);
+    }
+    rowScalar(out, up, mid, dn, old, x, x1);
+}
+
+WAVE_TARGET("avx2")
+static inline __m256 stencil8(__m256 up, __m256 dn, __m256 left, __m256 right, __m256 m, __m256 old) {
+    __m256 lap = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(up, dn), left), right);
+    lap = _mm256_sub_ps(lap, _mm256_mul_ps(_mm256_set1_ps(4.0f), m));
+    __m256 v = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(2.0f), m), old);
+    v = _mm256_add_ps(v, _mm256_mul_ps(_mm256_set1_ps(WAVE_C * WAVE_C), lap));
+    return _mm256_mul_ps(v, _mm256_set1_ps(WAVE_DAMPING));
+}
+
+WAVE_TARGET("avx2")
+static inline __m256 stencil8(const float* up, const float* mid, const float* dn, const float* old) {
+    return stencil8(_mm256_loadu_ps(up), _mm256_loadu_ps(dn), _mm256_loadu_ps(mid - 1),
+                    _mm256_loadu_ps(mid + 1), _mm256_loadu_ps(mid), _mm256_loadu_ps(old));
+}
+
+WAVE_TARGET("avx2,f16c")
+static inline __m256 widen8(const uint16_t* p) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+}
+
+WAVE_TARGET("avx2,f16c")
+static inline __m128i stencil8(const uint16_t* up, const uint16_t* mid, const uint16_t* dn, const uint16_t* old) {
+    __m256 v = stencil8(widen8(up), widen8(dn), widen8(mid - 1), widen8(mid + 1), widen8(mid), widen8(old));
+    return _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT);
+}
+
+WAVE_TARGET("avx2")
+static void rowAvx2(float* out, const float* up, const float* mid, const float* dn,
+                    const float* old, int x0, int x1) {
+    int x = x0;
+    for(; x + 16 <= x1; x += 16) {
+        __m256 a = stencil8(up + x, mid + x, dn + x, old + x);
+        __m256 b = stencil8(up + x + 8, mid + x + 8, dn + x + 8, old + x + 8);
+        _mm256_storeu_ps(out + x, a);
+        _mm256_storeu_ps(out + x + 8, b);
+    }
+    for(; x + 8 <= x1; x += 8)
+        _mm256_storeu_ps(out + x, stencil8(up + x, mid + x, dn + x, old + x));
+    rowScalar(out, up, mid, dn, old, x, x1);
+}
+
+WAVE_TARGET("avx2,f16c")
+static void rowAvx2Half(uint16_t* out, const uint16_t* up, const uint16_t* mid, const uint16_t* dn,
+                        const uint16_t* old, int x0, int x1) {
+    int x = x0;
+    for(; x + 16 <= x1; x += 16) {
+        __m128i a = stencil8(up + x, mid + x, dn + x, old + x);
+        __m128i b = stencil8(up + x + 8, mid + x + 8, dn + x + 8, old + x + 8);
+        _mm_storeu_si128((__m128i*)(out + x), a);
+        _mm_storeu_si128((__m128i*)(out + x + 8), b);
+    }
+    for(; x + 8 <= x1; x += 8)
+        _mm_storeu_si128((__m128i*)(out + x), stencil8(up + x, mid + x, dn + x, old + x));
+    rowScalarHalf(out, up, mid, dn, old, x, x1);
+}
+
+static bool cpuHasSse41() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+static bool cpuHasAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool cpuHasF16c() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 29)) != 0;
+#else
+    return __builtin_cpu_supports("f16c");
+#endif
+}
+#endif
+
+#ifdef WAVE_NEON
+static inline float32x4_t stencil4(float32x4_t up, float32x4_t dn, float32x4_t left, float32x4_t right,
+                                   float32x4_t m, float32x4_t old) {
+    float32x4_t lap = vaddq_f32(vaddq_f32(vaddq_f32(up, dn), left), right);
+    lap = vsubq_f32(lap, vmulq_f32(vdupq_n_f32(4.0f), m));
+    float32x4_t v = vsubq_f32(vmulq_f32(vdupq_n_f32(2.0f), m), old);
+    v = vaddq_f32(v, vmulq_f32(vdupq_n_f32(WAVE_C * WAVE_C), lap));
+    return vmulq_f32(v, vdupq_n_f32(WAVE_DAMPING));
+}
+
+static inline float32x4_t stencil4(const float* up, const float* mid, const float* dn, const float* old) {
+    return stencil4(vld1q_f32(up), vld1q_f32(dn), vld1q_f32(mid - 1), vld1q_f32(mid + 1),
+                    vld1q_f32(mid), vld1q_f32(old));
+}
+
+static inline float32x4_t widen4(const uint16_t* p) {
+    return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p)));
+}
+
+static inline uint16x4_t stencil4(const uint16_t* up, const uint16_t* mid, const uint16_t* dn, const uint16_t* old) {
+    float32x4_t v = stencil4(widen4(up), widen4(dn), widen4(mid - 1), widen4(mid + 1), widen4(mid), widen4(old));
+    return vreinterpret_u16_f16(vcvt_f16_f32(v));
+}
+
+static void rowNeon(float* out, const float* up, const float* mid, const float* dn,
+                    const float* old, int x0, int x1) {
+    int x = x0;
+    for(; x + 8 <= x1; x += 8) {
+        float32x4_t a = stencil4(up + x, mid + x, dn + x, old + x);
+        float32x4_t b = stencil4(up + x + 4, mid + x + 4, dn + x + 4, old + x + 4);
+        vst1q_f32(out + x, a);
+        vst1q_f32(out + x + 4, b);
+    }
+    rowScalar(out, up, mid, dn, old, x, x1);
+}
+
+static void rowNeonHalf(uint16_t* out, const uint16_t* up, const uint16_t* mid, const uint16_t* dn,
+                        const uint16_t* old, int x0, int x1) {
+    int x = x0;
+    for(; x + 8 <= x1; x += 8) {
+        uint16x4_t a = stencil4(up + x, mid + x, dn + x, old + x);
+        uint16x4_t b = stencil4(up + x + 4, mid + x + 4, dn + x + 4, old + x + 4);
+        vst1q_u16(out + x, vcombine_u16(a, b));
+    }
+    rowScalarHalf(out, up, mid, dn, old, x, x1);
+}
+#endif
+
+struct RowKernelChoice {
+    const char* name;
+    RowKernel fn;
+    HalfRowKernel half;
+};
+
+// Kernels this CPU can run. Wider isn't always faster: on a 2048x2048 grid
+// the step is memory-bound and AVX2 measured slower than SSE4.1, so the
+// solver times them on its own grid and keeps the fastest. Without F16C the
+// half kernels convert in software, which is correct but slower than the
+// float path.
+static std::vector<RowKernelChoice> rowKernels() {
+    std::vector<RowKernelChoice> kernels{{"scalar", rowScalar, rowScalarHalf}};
+#ifdef WAVE_X86
+    if(cpuHasSse41()) kernels.push_back({"SSE4.1", rowSse41, rowScalarHalf});
+    if(cpuHasAvx2()) kernels.push_back({"AVX2", rowAvx2, cpuHasF16c() ? rowAvx2Half : rowScalarHalf});
+#endif
+#ifdef WAVE_NEON
+    kernels.push_back({"NEON", rowNeon, rowNeonHalf});
+#endif
+    return kernels;
+}
+
+// Persistent workers for the solver. run() hands out task indices [0, n) and
+// returns once all of them are done; the calling thread takes tasks too, so a
+// pool of size 1 has no workers and runs everything inline.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return (int)workers.size() + 1; }
+    void run(int tasks, const std::function<void(int)>& fn);
+
+private:
+    void work();
+    void drain();
+
+    std::vector<std::thread> workers;
+    std::mutex m;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int)>* job = nullptr;
+    int jobTasks = 0;
+    std::atomic<int> nextTask{0};
+    int busy = 0;
+    unsigned generation = 0;
+    bool quit = false;
+};
+
+ThreadPool::ThreadPool(int threads) {
+    for(int i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        quit = true;
+    }
+    wake.notify_all();
+    for(auto& t : workers) t.join();
+}
+
+void ThreadPool::drain() {
+    for(int i; (i = nextTask.fetch_add(1)) < jobTasks; )
+        (*job)(i);
+}
+
+void ThreadPool::work() {
+    unsigned seen = 0;
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(m);
+            wake.wait(lock, [&]{ return quit || generation != seen; });
+            if(quit) return;
+            seen = generation;
         }
+        drain();
+        std::lock_guard<std::mutex> lock(m);
+        if(--busy == 0) done.notify_one();
     }
-    
-    prevWave = wave;
-    wave = newWave;
 }
 
-void addRipple(int x, int y, float strength) {
-    if(x < 0 || x >= GRID_W || y < 0 || y >= GRID_H) return;
-    
-    int radius = 4;
-    for(int dy = -radius; dy <= radius; dy++) {
-        for(int dx = -radius; dx <= radius; dx++) {
-            int nx = x + dx;
-            int ny = y + dy;
-            if(nx >= 0 && nx < GRID_W && ny >= 0 && ny < GRID_H) {
+void ThreadPool::run(int tasks, const std::function<void(int)>& fn) {
+    if(workers.empty() || tasks <= 1) {
+        for(int i = 0; i < tasks; i++) fn(i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m);
+        job = &fn;
+        jobTasks = tasks;
+        nextTask = 0;
+        busy = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+    drain();
+    std::unique_lock<std::mutex> lock(m);
+    done.wait(lock, [&]{ return busy == 0; });
+}
+
+// Half-open cell rectangle [x0, x1) x [y0, y1).
+struct Rect {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+    
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+    
+    Rect grow(int n, const Rect& bounds) const {
+        if(empty()) return *this;
+        return {std::max(x0 - n, bounds.x0), std::max(y0 - n, bounds.y0),
+                std::min(x1 + n, bounds.x1), std::min(y1 + n, bounds.y1)};
+    }
+    
+    Rect unite(const Rect& o) const {
+        if(empty()) return o;
+        if(o.empty()) return *this;
+        return {std::min(x0, o.x0), std::min(y0, o.y0), std::max(x1, o.x1), std::max(y1, o.y1)};
+    }
+};
+
+struct Ripple {
+    int x, y;
+    int radius;
+    float strength;
+};
+
+// Falloff weights of a ripple, (1 - d/r)^2 over the (2r-1)^2 cells around the
+// centre that lie within distance r. Built once per radius.
+struct RippleStamp {
+    int extent;
+    std::vector<float> weight;
+    
+    explicit RippleStamp(int radius) : extent(radius - 1) {
+        int size = 2 * extent + 1;
+        weight.assign(size * size, 0.0f);
+        for(int dy = -extent; dy <= extent; dy++) {
+            for(int dx = -extent; dx <= extent; dx++) {
                 float dist = sqrt(dx*dx + dy*dy);
                 if(dist < radius) {
                     float falloff = 1.0f - (dist / radius);
-                    wave[ny * GRID_W + nx] += strength * falloff * falloff;
+                    weight[(dy + extent) * size + dx + extent] = falloff * falloff;
+                }
+            }
+        }
+    }
+};
+
+const RippleStamp& rippleStamp(int radius) {
+    static std::map<int, RippleStamp> stamps;
+    auto it = stamps.find(radius);
+    if(it == stamps.end()) it = stamps.emplace(radius, RippleStamp(radius)).first;
+    return it->second;
+}
+
+// The stamps of a run of ripples summed over the box they cover, so the grid
+// takes them in one pass however much they overlap. The box stays inside
+// `bounds`, which keeps the pinned edge ring out of it.
+struct RippleField {
+    Rect box;
+    std::vector<float> delta;  // box.width() x box.height(), row by row
+    
+    void build(const Ripple* ripples, size_t n, const Rect& bounds) {
+        box = Rect{};
+        for(size_t i = 0; i < n; i++) {
+            const Ripple& r = ripples[i];
+            box = box.unite(Rect{r.x, r.y, r.x + 1, r.y + 1}.grow(rippleStamp(r.radius).extent, bounds));
+        }
+        delta.assign((size_t)std::max(box.width(), 0) * std::max(box.height(), 0), 0.0f);
+        for(size_t i = 0; i < n; i++) {
+            const Ripple& r = ripples[i];
+            const RippleStamp& stamp = rippleStamp(r.radius);
+            Rect touched = Rect{r.x, r.y, r.x + 1, r.y + 1}.grow(stamp.extent, bounds);
+            int size = 2 * stamp.extent + 1;
+            for(int y = touched.y0; y < touched.y1; y++) {
+                const float* weight = stamp.weight.data() + (y - r.y + stamp.extent) * size + stamp.extent - r.x;
+                float* row = delta.data() + (size_t)(y - box.y0) * box.width() - box.x0;
+                for(int x = touched.x0; x < touched.x1; x++)
+                    row[x] += r.strength * weight[x];
+            }
+        }
+    }
+};
+
+// Steps one call to WaveSolver::step() runs on a tile before it is left for
+// good. Each extra level keeps another row of each buffer in the working set.
+const int MAX_TEMPORAL_BLOCK = 4;
+
+// The solver tracks activity per WAVE_TILE square tile. A tile whose cells
+// all stay below QUIET_LEVEL counts as settled and is zeroed.
+const int WAVE_TILE = 32;
+const float QUIET_LEVEL = 1e-4f;
+
+// A wave moves one cell per step and a pass steps a one-tile halo around the
+// active tiles, so a pass must not outrun a tile.
+static_assert(MAX_TEMPORAL_BLOCK <= WAVE_TILE, "temporal block is wider than a tile");
+
+// One flag per WAVE_TILE square tile of a w x h cell grid, used to track
+// which parts of a field have changed.
+struct TileSet {
+    int w, h;
+    int cols, rows;
+    std::vector<unsigned char> flags;
+    
+    TileSet(int w, int h)
+        : w(w), h(h), cols((w + WAVE_TILE - 1) / WAVE_TILE), rows((h + WAVE_TILE - 1) / WAVE_TILE),
+          flags(cols * rows, 0) {}
+    
+    void clear() { std::fill(flags.begin(), flags.end(), 0); }
+    void markAll() { std::fill(flags.begin(), flags.end(), 1); }
+    
+    void mark(const Rect& r) {
+        if(r.empty()) return;
+        for(int ty = r.y0 / WAVE_TILE; ty <= (r.y1 - 1) / WAVE_TILE; ty++)
+            for(int tx = r.x0 / WAVE_TILE; tx <= (r.x1 - 1) / WAVE_TILE; tx++)
+                flags[ty * cols + tx] = 1;
+    }
+    
+    // One rectangle per tile row spanning its marked tiles, merged across
+    // consecutive rows with the same extent.
+    void toRects(std::vector<Rect>& rects) const {
+        rects.clear();
+        for(int ty = 0; ty < rows; ty++) {
+            int first = cols, last = -1;
+            for(int tx = 0; tx < cols; tx++) {
+                if(!flags[ty * cols + tx]) continue;
+                first = std::min(first, tx);
+                last = tx;
+            }
+            if(last < 0) continue;
+            
+            Rect r{first * WAVE_TILE, ty * WAVE_TILE,
+                   std::min((last + 1) * WAVE_TILE, w), std::min((ty + 1) * WAVE_TILE, h)};
+            if(!rects.empty() && rects.back().y1 == r.y0 && rects.back().x0 == r.x0 && rects.back().x1 == r.x1)
+                rects.back().y1 = r.y1;
+            else
+                rects.push_back(r);
+        }
+    }
+};
+
+// Leapfrog solver over three preallocated buffers of `storage` cells. A step writes the buffer
+// holding the oldest level from the other two and then rotates the pointers,
+// so stepping never allocates or copies the grid. The outer ring of cells is
+// a fixed boundary held at zero: only cells 1..w-2 of rows 1..h-2 are ever
+// written after clear().
+//
+// step(n) runs up to MAX_TEMPORAL_BLOCK steps per pass over the grid. The
+// stepped rows are split into one band per thread. Each band first advances
+// a shrinking trapezoid of rows, sweeping a diagonal wavefront so a row is
+// taken through every step while it is still in cache. A second parallel pass
+// then fills the inverted triangles left around each band edge.
+//
+// Only tiles that may hold nonzero cells are active. A pass steps the active
+// tiles plus a one-tile halo and then rescans them; a tile whose amplitude has
+// fallen below QUIET_LEVEL is zeroed in all three buffers and dropped. Every
+// inactive tile is therefore zero at every level and is skipped outright.
+// takeDirty() returns the tiles touched since the previous call, as one
+// rectangle per tile row merged across rows with the same extent.
+class WaveSolver {
+public:
+    WaveSolver(int w, int h, WaveStorage storage, ThreadPool& pool);
+    ~WaveSolver();
+    WaveSolver(const WaveSolver&) = delete;
+    WaveSolver& operator=(const WaveSolver&) = delete;
+
+    void step(int steps = 1);
+    void clear();
+    void addField(const RippleField& f);
+
+    const void* data() const { return cur; }
+    WaveStorage storage() const { return cells; }
+    int width() const { return w; }
+    int height() const { return h; }
+    const char* kernelName() const { return kernel.name; }
+    void takeDirty(std::vector<Rect>& rects);
+
+private:
+    struct Span { int x0, x1; };
+
+    RowKernelChoice pickKernel();
+    bool planPass();
+    void advance(int steps);
+    void stepRow(char* const* level, int k, int y) const;
+    template<class Cell, class Kernel>
+    void stepSpans(Kernel fn, char* const* level, int k, int y) const;
+    void settleTiles();
+    float tilePeak(int x0, int y0, int x1, int y1) const;
+
+    int w, h;
+    int tilesX, tilesY;
+    WaveStorage cells;
+    size_t cellBytes;
+    ThreadPool& pool;
+    RowKernelChoice kernel;
+    char* buf[3];
+    char* prev;
+    char* cur;
+    char* next;
+    std::vector<unsigned char> active;
+    std::vector<unsigned char> stepped;
+    TileSet dirty;
+    std::vector<Span> spans;    // cells stepped this pass, grouped by tile row
+    std::vector<int> rowSpans;  // first span of each tile row, plus the end
+    int rowLo = 0, rowHi = 0;   // rows stepped this pass
+};
+
+WaveSolver::WaveSolver(int w, int h, WaveStorage storage, ThreadPool& pool)
+    : w(w), h(h), tilesX((w + WAVE_TILE - 1) / WAVE_TILE), tilesY((h + WAVE_TILE - 1) / WAVE_TILE),
+      cells(storage), cellBytes(storageBytes(storage)), pool(pool),
+      dirty(w, h) {
+    size_t bytes = cellBytes * w * h;
+    bytes = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    for(int i = 0; i < 3; i++)
+        buf[i] = static_cast<char*>(::operator new(bytes, std::align_val_t(CACHE_LINE)));
+    prev = buf[0];
+    cur = buf[1];
+    next = buf[2];
+    active.resize(tilesX * tilesY);
+    stepped.resize(tilesX * tilesY);
+    rowSpans.reserve(tilesY + 1);
+    clear();
+    kernel = pickKernel();
+}
+
+// Steps the whole (zeroed) grid once with each kernel, best of five, and
+// returns the fastest. They are bit-identical, so this only picks speed.
+RowKernelChoice WaveSolver::pickKernel() {
+    using Clock = std::chrono::steady_clock;
+    std::vector<RowKernelChoice> kernels = rowKernels();
+    RowKernelChoice best = kernels[0];
+    double bestTime = 1e30;
+    for(const RowKernelChoice& k : kernels) {
+        for(int rep = 0; rep < 5; rep++) {
+            auto start = Clock::now();
+            for(int y = 1; y < h - 1; y++) {
+                if(cells == WaveStorage::Half) {
+                    const uint16_t* src = reinterpret_cast<const uint16_t*>(cur);
+                    k.half(reinterpret_cast<uint16_t*>(next) + y * w, src + (y - 1) * w, src + y * w,
+                           src + (y + 1) * w, reinterpret_cast<const uint16_t*>(prev) + y * w, 1, w - 1);
+                } else {
+                    const float* src = reinterpret_cast<const float*>(cur);
+                    k.fn(reinterpret_cast<float*>(next) + y * w, src + (y - 1) * w, src + y * w,
+                         src + (y + 1) * w, reinterpret_cast<const float*>(prev) + y * w, 1, w - 1);
                 }
             }
+            double t = std::chrono::duration<double>(Clock::now() - start).count();
+            if(t < bestTime) {
+                bestTime = t;
+                best = k;
+            }
+        }
+    }
+    return best;
+}
+
+WaveSolver::~WaveSolver() {
+    for(int i = 0; i < 3; i++)
+        ::operator delete(buf[i], std::align_val_t(CACHE_LINE));
+}
+
+void WaveSolver::clear() {
+    for(int i = 0; i < 3; i++)
+        memset(buf[i], 0, cellBytes * w * h);
+    std::fill(active.begin(), active.end(), 0);
+    dirty.markAll();
+}
+
+void WaveSolver::takeDirty(std::vector<Rect>& rects) {
+    dirty.toRects(rects);
+    dirty.clear();
+}
+
+// Computes row y of level k+2 from levels k+1 and k. Level j of the current
+// pass lives in level[j % 3], so this overwrites level k-1 in place.
+void WaveSolver::stepRow(char* const* level, int k, int y) const {
+    if(cells == WaveStorage::Half) stepSpans<uint16_t>(kernel.half, level, k, y);
+    else stepSpans<float>(kernel.fn, level, k, y);
+}
+
+template<class Cell, class Kernel>
+void WaveSolver::stepSpans(Kernel fn, char* const* level, int k, int y) const {
+    const Cell* src = reinterpret_cast<const Cell*>(level[(k + 1) % 3]);
+    const Cell* old = reinterpret_cast<const Cell*>(level[k % 3]) + y * w;
+    Cell* out = reinterpret_cast<Cell*>(level[(k + 2) % 3]) + y * w;
+    int ty = y / WAVE_TILE;
+    for(int s = rowSpans[ty]; s < rowSpans[ty + 1]; s++)
+        fn(out, src + (y - 1) * w, src + y * w, src + (y + 1) * w, old, spans[s].x0, spans[s].x1);
+}
+
+void WaveSolver::step(int steps) {
+    while(steps > 0) {
+        int k = std::min(steps, MAX_TEMPORAL_BLOCK);
+        advance(k);
+        steps -= k;
+    }
+}
+
+// Marks the active tiles and their halo for stepping and turns each tile row
+// into spans of interior cells. Returns false when there is nothing to step.
+bool WaveSolver::planPass() {
+    std::fill(stepped.begin(), stepped.end(), 0);
+    for(int ty = 0; ty < tilesY; ty++) {
+        for(int tx = 0; tx < tilesX; tx++) {
+            if(!active[ty * tilesX + tx]) continue;
+            for(int y = std::max(ty - 1, 0); y <= std::min(ty + 1, tilesY - 1); y++)
+                for(int x = std::max(tx - 1, 0); x <= std::min(tx + 1, tilesX - 1); x++)
+                    stepped[y * tilesX + x] = 1;
+        }
+    }
+    
+    spans.clear();
+    rowSpans.assign(1, 0);
+    int first = tilesY, last = -1;
+    for(int ty = 0; ty < tilesY; ty++) {
+        for(int tx = 0; tx < tilesX; tx++) {
+            if(!stepped[ty * tilesX + tx]) continue;
+            int x0 = std::max(tx * WAVE_TILE, 1);
+            int x1 = std::min((tx + 1) * WAVE_TILE, w - 1);
+            if(x0 >= x1) continue;
+            if((int)spans.size() > rowSpans.back() && spans.back().x1 == x0)
+                spans.back().x1 = x1;
+            else
+                spans.push_back({x0, x1});
+            first = std::min(first, ty);
+            last = ty;
+        }
+        rowSpans.push_back((int)spans.size());
+    }
+    if(last < 0) return false;
+    
+    rowLo = std::max(first * WAVE_TILE, 1);
+    rowHi = std::min((last + 1) * WAVE_TILE, h - 1);
+    return rowLo < rowHi;
+}
+
+void WaveSolver::advance(int steps) {
+    // with nothing active every buffer is zero, so the pass is a no-op
+    if(!planPass()) return;
+    
+    char* const level[3] = {prev, cur, next};
+    const int rows = rowHi - rowLo;
+    
+    // Rows outside [rowLo, rowHi) are zero at every level and never written,
+    // so the outer bands treat them like the fixed boundary. Bands must be at
+    // least 2*steps rows tall so the edge triangles of neighbouring bands
+    // never overlap.
+    int bands = std::max(1, std::min(pool.size(), rows / (2 * steps)));
+    auto bandStart = [&](int b) { return rowLo + (int)((long long)rows * b / bands); };
+    
+    pool.run(bands, [&](int b) {
+        int y0 = bandStart(b), y1 = bandStart(b + 1);
+        for(int front = y0; front < y1 + steps - 1; front++) {
+            for(int k = 0; k < steps; k++) {
+                int y = front - k;
+                int lo = (b == 0) ? rowLo : y0 + k;
+                int hi = (b == bands - 1) ? rowHi : y1 - k;
+                if(y >= lo && y < hi) stepRow(level, k, y);
+            }
+        }
+    });
+    
+    if(bands > 1 && steps > 1) {
+        pool.run(bands - 1, [&](int b) {
+            int edge = bandStart(b + 1);
+            for(int k = 1; k < steps; k++)
+                for(int y = edge - k; y < edge + k; y++)
+                    stepRow(level, k, y);
+        });
+    }
+    
+    prev = level[steps % 3];
+    cur = level[(steps + 1) % 3];
+    next = level[(steps + 2) % 3];
+    settleTiles();
+}
+
+// Largest height in either level the next step reads, over the given cells.
+float WaveSolver::tilePeak(int x0, int y0, int x1, int y1) const {
+    if(cells == WaveStorage::Half) {
+        // with the sign cleared, half bit patterns order like their magnitudes
+        uint16_t quiet = floatToHalf(QUIET_LEVEL), peak = 0;
+        for(int y = y0; y < y1 && peak <= quiet; y++) {
+            const uint16_t* a = reinterpret_cast<const uint16_t*>(cur) + y * w;
+            const uint16_t* b = reinterpret_cast<const uint16_t*>(prev) + y * w;
+            for(int x = x0; x < x1; x++)
+                peak = std::max({peak, (uint16_t)(a[x] & 0x7fff), (uint16_t)(b[x] & 0x7fff)});
+        }
+        return halfToFloat(peak);
+    }
+    float peak = 0.0f;
+    for(int y = y0; y < y1 && peak <= QUIET_LEVEL; y++) {
+        const float* a = reinterpret_cast<const float*>(cur) + y * w;
+        const float* b = reinterpret_cast<const float*>(prev) + y * w;
+        for(int x = x0; x < x1; x++)
+            peak = std::max(peak, std::max(std::fabs(a[x]), std::fabs(b[x])));
+    }
+    return peak;
+}
+
+// Rescans the tiles the last pass stepped. A tile stays active while either
+// level the next step reads has a cell above QUIET_LEVEL. Otherwise all three
+// buffers are zeroed over it, including what the oldest level still held.
+void WaveSolver::settleTiles() {
+    pool.run(tilesY, [&](int ty) {
+        int y0 = ty * WAVE_TILE, y1 = std::min(y0 + WAVE_TILE, h);
+        for(int tx = 0; tx < tilesX; tx++) {
+            int t = ty * tilesX + tx;
+            if(!stepped[t]) continue;
+            int x0 = tx * WAVE_TILE, x1 = std::min(x0 + WAVE_TILE, w);
+            
+            dirty.flags[t] = 1;
+            active[t] = tilePeak(x0, y0, x1, y1) > QUIET_LEVEL;
+            if(!active[t]) {
+                for(int i = 0; i < 3; i++)
+                    for(int y = y0; y < y1; y++)
+                        memset(buf[i] + cellBytes * (y * w + x0), 0, cellBytes * (x1 - x0));
+            }
+        }
+    });
+}
+
+void WaveSolver::addField(const RippleField& f) {
+    if(f.box.empty()) return;
+    dirty.mark(f.box);
+    for(int y = f.box.y0; y < f.box.y1; y++) {
+        const float* d = f.delta.data() + (size_t)(y - f.box.y0) * f.box.width() - f.box.x0;
+        unsigned char* tiles = active.data() + (y / WAVE_TILE) * tilesX;
+        if(cells == WaveStorage::Half) {
+            uint16_t* row = reinterpret_cast<uint16_t*>(cur) + y * w;
+            for(int x = f.box.x0; x < f.box.x1; x++) {
+                if(d[x] == 0.0f) continue;
+                row[x] = floatToHalf(halfToFloat(row[x]) + d[x]);
+                tiles[x / WAVE_TILE] = 1;
+            }
+        } else {
+            float* row = reinterpret_cast<float*>(cur) + y * w;
+            for(int x = f.box.x0; x < f.box.x1; x++) {
+                if(d[x] == 0.0f) continue;
+                row[x] += d[x];
+                tiles[x / WAVE_TILE] = 1;
+            }
+        }
+    }
+}
+
+// Keeps a texture in sync with the CPU field. The texture is allocated once,
+// as R32F or R16F to match the solver's cells;
+// each upload packs only the dirty rectangles into the next of three pixel
+// buffers and updates the texture from there, so the driver can overlap the
+// transfer with rendering. A fence per buffer keeps the CPU from overwriting
+// one the GPU is still reading.
+class TextureStreamer {
+public:
+    TextureStreamer(int w, int h, WaveStorage storage);
+    ~TextureStreamer();
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    void upload(const void* field, const std::vector<Rect>& rects);
+    GLuint texture() const { return tex; }
+
+private:
+    int w, h;
+    WaveStorage cells;
+    size_t cellBytes;
+    GLuint tex;
+    GLuint pbo[3];
+    GLsync fence[3] = {nullptr, nullptr, nullptr};
+    int slot = 0;
+};
+
+TextureStreamer::TextureStreamer(int w, int h, WaveStorage storage)
+    : w(w), h(h), cells(storage), cellBytes(storageBytes(storage)) {
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    if(cells == WaveStorage::Half)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, w, h, 0, GL_RED, GL_HALF_FLOAT, nullptr);
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    
+    glGenBuffers(3, pbo);
+    for(int i = 0; i < 3; i++) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, cellBytes * w * h, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureStreamer::~TextureStreamer() {
+    for(int i = 0; i < 3; i++)
+        if(fence[i]) glDeleteSync(fence[i]);
+    glDeleteBuffers(3, pbo);
+    glDeleteTextures(1, &tex);
+}
+
+void TextureStreamer::upload(const void* field, const std::vector<Rect>& rects) {
+    size_t count = 0;
+    for(const Rect& r : rects)
+        if(!r.empty()) count += (size_t)(r.x1 - r.x0) * (r.y1 - r.y0);
+    if(count == 0) return;
+    
+    slot = (slot + 1) % 3;
+    if(fence[slot]) {
+        glClientWaitSync(fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence[slot]);
+        fence[slot] = nullptr;
+    }
+    
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[slot]);
+    const char* src = static_cast<const char*>(field);
+    char* dst = static_cast<char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, cellBytes * count,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    if(dst) {
+        char* p = dst;
+        for(const Rect& r : rects) {
+            if(r.empty()) continue;
+            size_t rowBytes = cellBytes * (r.x1 - r.x0);
+            for(int y = r.y0; y < r.y1; y++, p += rowBytes)
+                memcpy(p, src + cellBytes * ((size_t)y * w + r.x0), rowBytes);
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, (GLint)cellBytes);
+        GLenum type = cells == WaveStorage::Half ? GL_HALF_FLOAT : GL_FLOAT;
+        size_t offset = 0;
+        for(const Rect& r : rects) {
+            if(r.empty()) continue;
+            int rw = r.x1 - r.x0, rh = r.y1 - r.y0;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, r.x0, r.y0, rw, rh, GL_RED, type, (void*)offset);
+            offset += cellBytes * rw * rh;
+        }
+        fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+// Hands finished fields from the simulation thread to the renderer without
+// either side waiting. Each of three slots holds a full copy of the field: the
+// writer fills its back slot and swaps it into the middle, and the reader swaps
+// the middle out for its front slot when the fresh bit says it holds a frame
+// not yet taken. A slot is refreshed only where the field changed since it was
+// last filled. The rectangles handed to the reader cover every change since
+// the last frame it is known to have taken, so skipped frames lose nothing.
+class FrameExchange {
+public:
+    FrameExchange(int w, int h, WaveStorage storage);
+    FrameExchange(const FrameExchange&) = delete;
+    FrameExchange& operator=(const FrameExchange&) = delete;
+
+    // writer
+    void publish(const void* field, const std::vector<Rect>& changed);
+    
+    // reader; returns false while no newer frame has been published
+    bool acquire();
+    const void* field() const { return slots[front].cells.data(); }
+    const std::vector<Rect>& dirty() const { return slots[front].dirty; }
+
+private:
+    static const int FRESH = 4;
+    
+    struct Slot {
+        std::vector<char> cells;
+        std::vector<Rect> dirty;
+        TileSet stale;
+        uint64_t seq = 0;
+        
+        Slot(int w, int h, size_t bytes) : cells(bytes), stale(w, h) { stale.markAll(); }
+    };
+    
+    int w;
+    size_t cellBytes;
+    std::vector<Slot> slots;
+    int back = 0, front = 1;
+    std::atomic<int> middle{2};
+    TileSet unseen;
+    uint64_t published = 0;
+    std::atomic<uint64_t> taken{0};
+    std::vector<Rect> copyRects;
+};
+
+FrameExchange::FrameExchange(int w, int h, WaveStorage storage)
+    : w(w), cellBytes(storageBytes(storage)), unseen(w, h) {
+    for(int i = 0; i < 3; i++)
+        slots.emplace_back(w, h, cellBytes * w * h);
+}
+
+void FrameExchange::publish(const void* field, const std::vector<Rect>& changed) {
+    // the reader has taken the newest frame, so it has seen every earlier change
+    if(taken.load(std::memory_order_acquire) == published) unseen.clear();
+    for(const Rect& r : changed) {
+        unseen.mark(r);
+        for(Slot& slot : slots) slot.stale.mark(r);
+    }
+    
+    Slot& slot = slots[back];
+    const char* src = static_cast<const char*>(field);
+    slot.stale.toRects(copyRects);
+    slot.stale.clear();
+    for(const Rect& r : copyRects) {
+        for(int y = r.y0; y < r.y1; y++) {
+            size_t offset = cellBytes * ((size_t)y * w + r.x0);
+            memcpy(slot.cells.data() + offset, src + offset, cellBytes * (r.x1 - r.x0));
+        }
+    }
+    unseen.toRects(slot.dirty);
+    slot.seq = ++published;
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+}
+
+bool FrameExchange::acquire() {
+    if(!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+    front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+    taken.store(slots[front].seq, std::memory_order_release);
+    return true;
+}
+
+ThreadPool* pool = nullptr;  // only the CPU solver needs workers
+WaveSolver* solver = nullptr;
+
+// Converts frame time into whole solver steps of `dt` seconds. A frame runs
+// at most maxSteps of them; time past the cap is dropped rather than carried,
+// so one slow frame can't snowball into ever longer catch-up frames.
+struct FixedStep {
+    double dt;
+    int maxSteps;
+    double acc = 0.0;
+    
+    int advance(double frameTime) {
+        acc += frameTime;
+        int n = (int)(acc / dt);
+        if(n > maxSteps) {
+            n = maxSteps;
+            acc = 0.0;
+        } else {
+            acc -= n * dt;
         }
+        return n;
+    }
+};
+
+// GPU-resident counterpart of WaveSolver. The three levels are R32F textures,
+// each with its own framebuffer; a step renders the stencil into the oldest
+// one and rotates the indices, and ripples are an additive draw of a
+// RippleField into the current one. Float render targets and blending are
+// core in GL 3.3, so this also runs on software rasterizers such as llvmpipe.
+class GpuWaveSim {
+public:
+    GpuWaveSim(int w, int h, GLuint quadVao);
+    ~GpuWaveSim();
+    GpuWaveSim(const GpuWaveSim&) = delete;
+    GpuWaveSim& operator=(const GpuWaveSim&) = delete;
+
+    void step(int steps = 1);
+    void clear();
+    void addField(const RippleField& f);
+
+    GLuint texture() const { return tex[cur]; }
+
+private:
+    void bindTarget(int level);
+
+    int w, h;
+    GLuint vao;
+    GLuint tex[3];
+    GLuint fbo[3];
+    GLuint stepProg, fieldProg;
+    GLuint fieldTex;
+    int prev = 0, cur = 1, next = 2;
+};
+
+GpuWaveSim::GpuWaveSim(int w, int h, GLuint quadVao) : w(w), h(h), vao(quadVao) {
+    glGenTextures(3, tex);
+    glGenFramebuffers(3, fbo);
+    for(int i = 0; i < 3; i++) {
+        glBindTexture(GL_TEXTURE_2D, tex[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex[i], 0);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr<<"Wave framebuffer incomplete"<<std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    stepProg = mkProg(simVtx, stepFrag);
+    fieldProg = mkProg(fieldVtx, fieldFrag);
+    glGenTextures(1, &fieldTex);
+    glBindTexture(GL_TEXTURE_2D, fieldTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    
+    glUseProgram(stepProg);
+    glUniform1i(glGetUniformLocation(stepProg, "cur"), 0);
+    glUniform1i(glGetUniformLocation(stepProg, "prev"), 1);
+    glUniform1f(glGetUniformLocation(stepProg, "c2"), WAVE_C * WAVE_C);
+    glUniform1f(glGetUniformLocation(stepProg, "damping"), WAVE_DAMPING);
+    glUseProgram(fieldProg);
+    glUniform2f(glGetUniformLocation(fieldProg, "gridSize"), (float)w, (float)h);
+    glUniform1i(glGetUniformLocation(fieldProg, "field"), 0);
+    
+    clear();
+}
+
+GpuWaveSim::~GpuWaveSim() {
+    glDeleteFramebuffers(3, fbo);
+    glDeleteTextures(3, tex);
+    glDeleteProgram(stepProg);
+    glDeleteProgram(fieldProg);
+    glDeleteTextures(1, &fieldTex);
+}
+
+void GpuWaveSim::bindTarget(int level) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo[level]);
+    glViewport(0, 0, w, h);
+}
+
+void GpuWaveSim::clear() {
+    const float zero[4] = {0, 0, 0, 0};
+    for(int i = 0; i < 3; i++) {
+        bindTarget(i);
+        glClearBufferfv(GL_COLOR, 0, zero);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GpuWaveSim::step(int steps) {
+    glUseProgram(stepProg);
+    glBindVertexArray(vao);
+    for(int i = 0; i < steps; i++) {
+        bindTarget(next);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, tex[prev]);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, tex[cur]);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        
+        int recycled = prev;
+        prev = cur;
+        cur = next;
+        next = recycled;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GpuWaveSim::addField(const RippleField& f) {
+    if(f.box.empty()) return;
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, fieldTex);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, f.box.width(), f.box.height(), 0, GL_RED, GL_FLOAT, f.delta.data());
+    bindTarget(cur);
+    glUseProgram(fieldProg);
+    glUniform4f(glGetUniformLocation(fieldProg, "box"), (float)f.box.x0, (float)f.box.y0,
+                (float)f.box.x1, (float)f.box.y1);
+    
+    // the edge ring stays pinned at zero, as on the CPU
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(1, 1, w - 2, h - 2);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBindVertexArray(vao);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GpuWaveSim* gpuSim = nullptr;
+
+// Fixed-capacity ring with one producer and one consumer thread. push() and
+// pop() never block or allocate; push() fails when the ring is full.
+template<class T, size_t N>
+class SpscQueue {
+public:
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if(t - head.load(std::memory_order_acquire) == N) return false;
+        items[t % N] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if(h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h % N];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[N];
+    alignas(CACHE_LINE) std::atomic<size_t> head{0};
+    alignas(CACHE_LINE) std::atomic<size_t> tail{0};
+};
+
+struct WaveEvent {
+    enum Type { AddRipple, Clear } type;
+    Ripple ripple;
+};
+
+// Input from the render thread to whichever thread steps the solver. The ring
+// holds far more than a frame of input; if it ever fills, events are dropped.
+SpscQueue<WaveEvent, 4096> waveEvents;
+
+void addRipple(int x, int y, float strength) {
+    if(x < 0 || x >= gridW || y < 0 || y >= gridH) return;
+    waveEvents.push({WaveEvent::AddRipple, {x, y, RIPPLE_RADIUS, strength}});
+}
+
+void clearWaves() {
+    waveEvents.push({WaveEvent::Clear, {}});
+}
+
+// Ripples taken off the queue are applied together right before the next
+// solver step. A drag queues its points in order, about a cell apart, so
+// runs of consecutive ripples are summed into one RippleField and the grid
+// takes each run in a single pass however much its stamps overlap. A run
+// ends once its centres would span more than FIELD_SPAN cells either way,
+// which keeps scattered splashes from making one huge, mostly empty field.
+const int FIELD_SPAN = 64;
+std::vector<Ripple> pendingRipples;
+RippleField pendingField;
+
+void flushRipples() {
+    Rect interior{1, 1, gridW - 1, gridH - 1};
+    for(size_t start = 0; start < pendingRipples.size();) {
+        const Ripple& first = pendingRipples[start];
+        Rect centres{first.x, first.y, first.x + 1, first.y + 1};
+        size_t end = start + 1;
+        for(; end < pendingRipples.size(); end++) {
+            const Ripple& r = pendingRipples[end];
+            Rect grown = centres.unite(Rect{r.x, r.y, r.x + 1, r.y + 1});
+            if(grown.width() > FIELD_SPAN || grown.height() > FIELD_SPAN) break;
+            centres = grown;
+        }
+        pendingField.build(pendingRipples.data() + start, end - start, interior);
+        if(gpuSim) gpuSim->addField(pendingField);
+        else solver->addField(pendingField);
+        start = end;
+    }
+    pendingRipples.clear();
+}
+
+// Drains the input queue into the running solver. Only the thread stepping
+// the solver calls this, so pendingRipples needs no lock.
+void applyWaveEvents() {
+    WaveEvent e;
+    while(waveEvents.pop(e)) {
+        if(e.type == WaveEvent::Clear) {
+            pendingRipples.clear();
+            if(gpuSim) gpuSim->clear();
+            else solver->clear();
+        } else {
+            pendingRipples.push_back(e.ripple);
+        }
+    }
+    flushRipples();
+}
+
+// Steps the CPU solver on its own thread at a fixed tick rate and publishes
+// each result, so vsync waits on the render thread and slow steps no longer
+// stall each other.
+class SimThread {
+public:
+    SimThread(WaveSolver& solver, FrameExchange& frames, double rate, int maxSubsteps);
+    ~SimThread();
+    SimThread(const SimThread&) = delete;
+    SimThread& operator=(const SimThread&) = delete;
+
+private:
+    void run();
+
+    WaveSolver& solver;
+    FrameExchange& frames;
+    FixedStep clock;
+    std::atomic<bool> running{true};
+    std::thread thread;
+};
+
+SimThread::SimThread(WaveSolver& solver, FrameExchange& frames, double rate, int maxSubsteps)
+    : solver(solver), frames(frames), clock{1.0 / rate, maxSubsteps}, thread(&SimThread::run, this) {}
+
+SimThread::~SimThread() {
+    running = false;
+    thread.join();
+}
+
+void SimThread::run() {
+    using Clock = std::chrono::steady_clock;
+    auto tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(clock.dt));
+    std::vector<Rect> changed;
+    Clock::time_point last = Clock::now(), next = last;
+    
+    while(running.load(std::memory_order_relaxed)) {
+        // after an overrun, start the next tick right away instead of
+        // sleeping through the backlog
+        next = std::max(next + tick, Clock::now());
+        std::this_thread::sleep_until(next);
+        
+        Clock::time_point now = Clock::now();
+        int steps = clock.advance(std::chrono::duration<double>(now - last).count());
+        last = now;
+        if(steps == 0) continue;
+        
+        applyWaveEvents();
+        solver.step(steps);
+        solver.takeDirty(changed);
+        frames.publish(solver.data(), changed);
     }
 }
 
@@ -154,8 +1471,8 @@ void cursor_pos_callback(GLFWwindow* w, double xpos, double ypos) {
         int ww, wh;
         glfwGetWindowSize(w, &ww, &wh);
         
-        int gridX = (int)(xpos / ww * GRID_W);
-        int gridY = (int)(ypos / wh * GRID_H);
+        int gridX = (int)(xpos / ww * gridW);
+        int gridY = (int)(ypos / wh * gridH);
         
         addRipple(gridX, gridY, 0.3f);
         
@@ -177,7 +1494,53 @@ void cursor_pos_callback(GLFWwindow* w, double xpos, double ypos) {
     }
 }
 
-int main(){
+const char* usage =
+    "Usage: waves [options]\n"
+    "  --grid WxH          simulation grid size (default 256x256)\n"
+    "  --rate N            solver steps per second (default 60)\n"
+    "  --max-substeps N    most solver steps run for one frame (default 8)\n"
+    "  --storage f32|f16   cell format of the CPU solver (default f32)\n"
+    "  --gpu               run the solver on the GPU\n";
+
+int main(int argc, char** argv){
+    bool useGpu = false;
+    WaveStorage storage = WaveStorage::Float;
+    double rate = 60.0;
+    int maxSubsteps = 8;
+    for(int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = true;
+        if(strcmp(arg, "--gpu") == 0) {
+            useGpu = true;
+        } else if(strcmp(arg, "--grid") == 0 && val) {
+            ok = sscanf(val, "%dx%d", &gridW, &gridH) == 2 && gridW >= 3 && gridH >= 3;
+            i++;
+        } else if(strcmp(arg, "--storage") == 0 && val) {
+            ok = strcmp(val, "f32") == 0 || strcmp(val, "f16") == 0;
+            storage = strcmp(val, "f16") == 0 ? WaveStorage::Half : WaveStorage::Float;
+            i++;
+        } else if(strcmp(arg, "--rate") == 0 && val) {
+            rate = atof(val);
+            ok = rate > 0.0;
+            i++;
+        } else if(strcmp(arg, "--max-substeps") == 0 && val) {
+            maxSubsteps = atoi(val);
+            ok = maxSubsteps >= 1;
+            i++;
+        } else {
+            ok = false;
+        }
+        if(!ok) {
+            std::cerr<<"Bad option: "<<arg<<"\n"<<usage;
+            return -1;
+        }
+    }
+    if(useGpu && storage != WaveStorage::Float) {
+        std::cerr<<"--storage f16 is only supported by the CPU solver\n"<<usage;
+        return -1;
+    }
+    
     if(!glfwInit()){
         std::cerr<<"GLFW init fail"<<std::endl;
         return -1;
@@ -230,48 +1593,75 @@ int main(){
     glVertexAttribPointer(1,2,GL_FLOAT,GL_FALSE,5*sizeof(float),(void*)(3*sizeof(float)));
     glEnableVertexAttribArray(1);
     
-    GLuint waveTex;
-    glGenTextures(1, &waveTex);
-    glBindTexture(GL_TEXTURE_2D, waveTex);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    GLint maxTex;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTex);
+    if(gridW > maxTex || gridH > maxTex) {
+        std::cerr<<"Grid larger than the "<<maxTex<<" texel texture limit"<<std::endl;
+        return -1;
+    }
+    
+    TextureStreamer* streamer = nullptr;
+    FrameExchange* frames = nullptr;
+    if(useGpu) {
+        gpuSim = new GpuWaveSim(gridW, gridH, vao);
+        std::cout<<"Wave solver: GPU, "<<gridW<<"x"<<gridH<<std::endl;
+    } else {
+        pool = new ThreadPool(std::max(1u, std::thread::hardware_concurrency()));
+        solver = new WaveSolver(gridW, gridH, storage, *pool);
+        streamer = new TextureStreamer(gridW, gridH, storage);
+        frames = new FrameExchange(gridW, gridH, storage);
+        std::cout<<"Wave kernel: "<<solver->kernelName()
+                 <<(storage == WaveStorage::Half ? " half" : " float")<<", "<<gridW<<"x"<<gridH
+                 <<", "<<pool->size()<<" threads"<<std::endl;
+    }
     
-    GLuint prog=mkProg();
+    GLuint prog=mkProg(vtx,frag);
     glm::mat4 mdl=glm::mat4(1.0f);
     glm::mat4 view=glm::translate(glm::mat4(1.0f),glm::vec3(0,0,-3));
     
-    addRipple(GRID_W/2, GRID_H/2, 1.0f);
+    addRipple(gridW/2, gridH/2, 1.0f);
     
+    // the GPU solver steps on this thread; the CPU one gets its own
+    FixedStep clock{1.0 / rate, maxSubsteps};
+    SimThread* sim = nullptr;
+    if(solver) {
+        std::vector<Rect> changed;
+        solver->takeDirty(changed);
+        frames->publish(solver->data(), changed);
+        sim = new SimThread(*solver, *frames, rate, maxSubsteps);
+    }
     double lastTime = glfwGetTime();
     
     while(!glfwWindowShouldClose(win)){
         double currentTime = glfwGetTime();
-        float dt = currentTime - lastTime;
+        double dt = currentTime - lastTime;
         lastTime = currentTime;
         
         if(glfwGetKey(win,GLFW_KEY_ESCAPE)==GLFW_PRESS)
             glfwSetWindowShouldClose(win,true);
         
-        if(glfwGetKey(win,GLFW_KEY_R)==GLFW_PRESS) {
-            std::fill(wave.begin(), wave.end(), 0.0f);
-            std::fill(prevWave.begin(), prevWave.end(), 0.0f);
-        }
+        if(glfwGetKey(win,GLFW_KEY_R)==GLFW_PRESS)
+            clearWaves();
         
         if(glfwGetKey(win,GLFW_KEY_SPACE)==GLFW_PRESS) {
             static double lastSpaceTime = 0;
             if(currentTime - lastSpaceTime > 0.3) {
-                addRipple(rand() % GRID_W, rand() % GRID_H, 1.0f);
+                addRipple(rand() % gridW, rand() % gridH, 1.0f);
                 lastSpaceTime = currentTime;
             }
         }
         
-        //UPDATE NOTE: lower entropy (remove after bashing)
-        updateWave(0.016f);
+        if(gpuSim) {
+            int substeps = clock.advance(dt);
+            if(substeps > 0) {
+                applyWaveEvents();
+                gpuSim->step(substeps);
+            }
+        }
         
         int w,h;
         glfwGetFramebufferSize(win,&w,&h);
+        glViewport(0,0,w,h);
         float asp=(float)w/(float)h;
         glm::mat4 proj=glm::perspective(glm::radians(45.0f),asp,0.1f,100.0f);
         
@@ -279,12 +1669,18 @@ int main(){
         glClear(GL_COLOR_BUFFER_BIT);
         glUseProgram(prog);
         
-        glBindTexture(GL_TEXTURE_2D, waveTex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, GRID_W, GRID_H, 0, GL_RED, GL_FLOAT, wave.data());
+        if(gpuSim) {
+            glBindTexture(GL_TEXTURE_2D, gpuSim->texture());
+        } else {
+            if(frames->acquire())
+                streamer->upload(frames->field(), frames->dirty());
+            glBindTexture(GL_TEXTURE_2D, streamer->texture());
+        }
         
         float tm=glfwGetTime();
         glUniform1f(glGetUniformLocation(prog,"t"),tm);
         glUniform1i(glGetUniformLocation(prog,"waveTex"),0);
+        glUniform1f(glGetUniformLocation(prog,"calm"),gpuSim ? 0.0f : QUIET_LEVEL);
         glUniformMatrix4fv(glGetUniformLocation(prog,"m"),1,GL_FALSE,glm::value_ptr(mdl));
         glUniformMatrix4fv(glGetUniformLocation(prog,"v"),1,GL_FALSE,glm::value_ptr(view));
         glUniformMatrix4fv(glGetUniformLocation(prog,"p"),1,GL_FALSE,glm::value_ptr(proj));
@@ -298,7 +1694,12 @@ int main(){
     glDeleteVertexArrays(1,&vao);
     glDeleteBuffers(1,&vbo);
     glDeleteBuffers(1,&ebo);
-    glDeleteTextures(1,&waveTex);
+    delete sim;
+    delete frames;
+    delete streamer;
+    delete gpuSim;
+    delete solver;
+    delete pool;
     glDeleteProgram(prog);
     glfwTerminate();
     return 0;